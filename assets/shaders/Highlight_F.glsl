@@ -1,10 +1,10 @@
 #version 330 core
 
-out vec4 gl_FragColor;
+out vec4 f_Color;
 
 uniform vec3 u_Color;
 
 void main()
 {
-    gl_FragColor = vec4(u_Color, 1.0);
+    f_Color = vec4(u_Color, 1.0);
 }
\ No newline at end of file
@@ -2,9 +2,24 @@
 
 layout (location = 0) in vec3 a_Position;
 
+struct DirLight
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    vec3 direction;
+};
+
+// written once per frame by the renderer, same layout in every shader
+layout (std140, row_major) uniform Frame
+{
+    mat4 u_View;
+    mat4 u_NoTranslateView;
+    mat4 u_Projection;
+    DirLight u_Light;
+};
+
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
 
 void main()
 {
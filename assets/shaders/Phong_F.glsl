@@ -16,14 +16,24 @@ struct DirLight
     vec3 direction;
 };
 
-out vec4 gl_FragColor;
+// written once per frame by the renderer, same layout in every shader
+layout (std140, row_major) uniform Frame
+{
+    mat4 u_View;
+    mat4 u_NoTranslateView;
+    mat4 u_Projection;
+    DirLight u_Light;
+};
+
+out vec4 f_Color;
 
 in vec3 v_Position;
 in vec3 v_Normal;
+in vec3 v_Color;
+in vec4 v_Specular;
 
 uniform Material u_Material;
-uniform DirLight u_Light;
-uniform mat4 u_View;
+uniform bool u_Instanced;
 
 void main()
 {
@@ -35,9 +45,15 @@ void main()
     float lDotn = dot(light, normal);
     float vDotr = dot(view, reflect);
 
-    vec3 ambient = u_Light.ambient * u_Material.ambient;
-    vec3 diffuse = u_Light.diffuse * u_Material.diffuse * max(lDotn, 0.0);
-    vec3 specular = u_Light.specular * u_Material.specular * pow(max(vDotr, 0.0), u_Material.shininess);
+    // instances carry their own material, color in place of ambient and diffuse and the shininess in the specular's w
+    vec3 materialAmbient = u_Instanced ? v_Color : u_Material.ambient;
+    vec3 materialDiffuse = u_Instanced ? v_Color : u_Material.diffuse;
+    vec3 materialSpecular = u_Instanced ? v_Specular.rgb : u_Material.specular;
+    float materialShininess = u_Instanced ? v_Specular.w : float(u_Material.shininess);
+
+    vec3 ambient = u_Light.ambient * materialAmbient;
+    vec3 diffuse = u_Light.diffuse * materialDiffuse * max(lDotn, 0.0);
+    vec3 specular = u_Light.specular * materialSpecular * pow(max(vDotr, 0.0), materialShininess);
 
-    gl_FragColor = vec4(ambient + diffuse + specular, 1.0);
+    f_Color = vec4(ambient + diffuse + specular, 1.0);
 }
\ No newline at end of file
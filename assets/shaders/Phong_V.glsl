@@ -3,17 +3,66 @@
 layout (location = 0) in vec3 a_Position;
 layout (location = 1) in vec3 a_Normal;
 
+// per-instance, only read when u_Instanced is set
+layout (location = 2) in vec3 a_InstancePosition;
+layout (location = 3) in vec3 a_InstanceForward;
+layout (location = 4) in vec3 a_InstanceColor;
+layout (location = 5) in vec4 a_InstanceSpecular;
+
+struct DirLight
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    vec3 direction;
+};
+
+// written once per frame by the renderer, same layout in every shader
+layout (std140, row_major) uniform Frame
+{
+    mat4 u_View;
+    mat4 u_NoTranslateView;
+    mat4 u_Projection;
+    DirLight u_Light;
+};
+
 out vec3 v_Position;
 out vec3 v_Normal;
+out vec3 v_Color;
+out vec4 v_Specular;
 
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
 uniform mat4 u_NormalMat;
+uniform bool u_Instanced;
+
+// same matrix as Boid::ComputeModel, translate * yaw * pitch turning the mesh's -z onto forward
+mat4 ComputeModel(vec3 position, vec3 direction)
+{
+    vec3 forward = normalize(direction);
+    vec3 level = vec3(forward.x, 0.0, forward.z);
+    level = length(level) < 1e-5 ? vec3(1.0, 0.0, 0.0) : normalize(level);
+
+    vec3 right = vec3(-level.z, 0.0, level.x);
+    vec3 back = -forward;
+    vec3 up = cross(back, right);
+    return mat4(vec4(right, 0.0), vec4(up, 0.0), vec4(back, 0.0), vec4(position, 1.0));
+}
 
 void main()
 {
-    v_Position = (u_View * u_Model * vec4(a_Position, 1.0)).xyz;
-    v_Normal = (u_NormalMat * vec4(normalize(a_Normal), 0.0)).xyz;
+    mat4 model = u_Model;
+    mat4 normalMat = u_NormalMat;
+    v_Color = vec3(0.0);
+    v_Specular = vec4(0.0);
+    if(u_Instanced) {
+        // rotation and translation only, so the view-model matrix is its own normal matrix
+        model = ComputeModel(a_InstancePosition, a_InstanceForward);
+        normalMat = u_View * model;
+        v_Color = a_InstanceColor;
+        v_Specular = a_InstanceSpecular;
+    }
+
+    v_Position = (u_View * model * vec4(a_Position, 1.0)).xyz;
+    v_Normal = (normalMat * vec4(normalize(a_Normal), 0.0)).xyz;
     gl_Position = u_Projection * vec4(v_Position, 1.0);
-}
\ No newline at end of file
+}
@@ -1,6 +1,6 @@
 #version 330 core
 
-out vec4 gl_FragColor;
+out vec4 f_Color;
 
 in vec3 v_TexCoord;
 
@@ -8,5 +8,5 @@ uniform samplerCube u_Skybox;
 
 void main()
 {
-    gl_FragColor = texture(u_Skybox, v_TexCoord);
+    f_Color = texture(u_Skybox, v_TexCoord);
 }
\ No newline at end of file
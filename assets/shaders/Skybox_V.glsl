@@ -4,11 +4,25 @@ layout (location = 0) in vec3 a_Position;
 
 out vec3 v_TexCoord;
 
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+struct DirLight
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    vec3 direction;
+};
+
+// written once per frame by the renderer, same layout in every shader
+layout (std140, row_major) uniform Frame
+{
+    mat4 u_View;
+    mat4 u_NoTranslateView;
+    mat4 u_Projection;
+    DirLight u_Light;
+};
 
 void main()
 {
     v_TexCoord = a_Position;
-    gl_Position = (u_Projection * u_View * vec4(a_Position, 1.0)).xyww;
+    gl_Position = (u_Projection * u_NoTranslateView * vec4(a_Position, 1.0)).xyww;
 }
\ No newline at end of file
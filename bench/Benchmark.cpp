@@ -0,0 +1,413 @@
+#include "Flock.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// runs the flock step headless over a grid of sizes and modes and prints the results as json
+// usage: FlockingBenchmark.exe [--sizes 1000,10000] [--search grid,octree] [--steps N] [--distance D] [--slices K] [--species N] [--seed S] [--out file.json]
+
+#define BENCHMARK_WARMUP_STEPS 2
+#define BENCHMARK_BRUTE_FORCE_MAX 20000
+#define BENCHMARK_CLUSTER_COUNT 8
+#define BENCHMARK_CLUSTER_RADIUS (BOUND_SIZE / 8.0f)
+
+// boids nearer than this fraction of the separation distance to their nearest neighbor count as crowded
+#define BENCHMARK_CROWDED_FRACTION 0.5f
+
+// with several species each keeps more apart from, and follows less of, the others than its own kind
+#define BENCHMARK_CROSS_SEPARATE 1.5f
+#define BENCHMARK_CROSS_ALIGN 0.5f
+#define BENCHMARK_CROSS_COHERE 0.5f
+
+// where the gui camera starts, only the level of detail mode looks at it
+#define BENCHMARK_VIEWER Point(0.0f, 0.0f, 60.0f)
+
+#pragma region modes
+
+struct SearchMode
+{
+    const char *name;
+    void (*configure)(FlockOptions& options);
+    int maxBoids;
+};
+
+struct ThreadingMode
+{
+    const char *name;
+    bool doubleBuffered;
+    bool allThreads;
+};
+
+struct Distribution
+{
+    const char *name;
+    void (*place)(FlockStore& store);
+};
+
+static void PlaceUniform(FlockStore&)
+{
+    // Flock::Init already spreads the boids over the bound
+}
+
+static void PlaceClustered(FlockStore& store)
+{
+    // dense balls with empty space between them, like a flock that has clumped up
+    Point centers[BENCHMARK_CLUSTER_COUNT];
+    for(Point& center : centers)
+        center = Point(Random(-BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f), Random(-BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f), Random(-BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f));
+
+    for(int i = 0; i < store.GetCount(); i++) {
+        Point position = centers[i % BENCHMARK_CLUSTER_COUNT] + Random(0.0f, BENCHMARK_CLUSTER_RADIUS) * RandomUnitSphere();
+        position.x = Clamp(position.x, -BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f);
+        position.y = Clamp(position.y, -BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f);
+        position.z = Clamp(position.z, -BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f);
+        store.SetPosition(i, position);
+    }
+}
+
+static void ConfigureBruteForce(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::BruteForce;
+}
+
+static void ConfigureGrid(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::Grid;
+}
+
+static void ConfigureGridUnsorted(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::Grid;
+    options.sortInterval = 0;
+}
+
+static void ConfigureGridIncremental(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::Grid;
+    options.incrementalGrid = true;
+}
+
+static void ConfigureOctree(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::Octree;
+}
+
+static void ConfigureTopological(FlockOptions& options)
+{
+    options.topological = true;
+}
+
+static void ConfigureGridAggregates(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::Grid;
+    options.cellAggregates = true;
+}
+
+static void ConfigureGridUnfused(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::Grid;
+    options.fusedSteering = false;
+}
+
+static void ConfigureGridHalfShell(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::Grid;
+    options.fusedSteering = false;
+    options.halfShellSeparation = true;
+}
+
+static void ConfigureGridLists(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::Grid;
+    options.neighborLists = true;
+}
+
+static void ConfigureGridLod(FlockOptions& options)
+{
+    options.neighborSearch = NeighborSearch::Grid;
+    options.lod = true;
+}
+
+static const SearchMode s_SearchModes[] = {
+    { "brute_force",      ConfigureBruteForce,      BENCHMARK_BRUTE_FORCE_MAX },
+    { "grid",             ConfigureGrid,            BOID_COUNT_MAX },
+    { "grid_unsorted",    ConfigureGridUnsorted,    BOID_COUNT_MAX },
+    { "grid_incremental", ConfigureGridIncremental, BOID_COUNT_MAX },
+    { "octree",           ConfigureOctree,          BOID_COUNT_MAX },
+    { "grid_aggregate",   ConfigureGridAggregates,  BOID_COUNT_MAX },
+    { "grid_unfused",     ConfigureGridUnfused,     BOID_COUNT_MAX },
+    { "grid_half_shell",  ConfigureGridHalfShell,   BOID_COUNT_MAX },
+    { "grid_lists",       ConfigureGridLists,       BOID_COUNT_MAX },
+    { "knn",              ConfigureTopological,     BOID_COUNT_MAX },
+    { "grid_lod",         ConfigureGridLod,         BOID_COUNT_MAX },
+};
+
+static const Distribution s_Distributions[] = {
+    { "uniform",    PlaceUniform },
+    { "clustered",  PlaceClustered },
+};
+
+static const ThreadingMode s_ThreadingModes[] = {
+    { "in_place",               false,  false },
+    { "double_buffered_1",      true,   false },
+    { "double_buffered_all",    true,   true },
+};
+
+#pragma endregion
+
+#pragma region measurement
+
+struct BenchmarkResult
+{
+    int boids;
+    const char *distribution;
+    const char *search;
+    const char *threading;
+    int threads;
+    int steps;
+    float distance;
+    int slices;
+    int species;
+    double mean, median, p99;
+    double indexMs;
+    double neighborCandidates;
+    double neighborLines;
+    double separationTests;
+    double separationPairs;
+    double polarization;
+    double crowded;
+    double cacheMisses;
+};
+
+static double Percentile(std::vector<double> values, double fraction)
+{
+    std::sort(values.begin(), values.end());
+    int index = Clamp((int)(fraction * (values.size() - 1) + 0.5), 0, (int)values.size() - 1);
+    return values[index];
+}
+
+static void MeasureStability(Flock& flock, BenchmarkResult& result)
+{
+    // polarization is the length of the mean heading, 1 when every boid flies the same way
+    const FlockStore& store = flock.GetStore();
+    int count = store.GetCount();
+    Vector heading;
+    for(int i = 0; i < count; i++)
+        heading = heading + store.GetForward(i);
+    result.polarization = count > 0 ? heading.Magnitude() / count : 0.0;
+
+    // separation failures show up as boids sitting on top of their nearest neighbor
+    KdTree tree;
+    tree.Build(store, flock.GetOptions().periodic);
+    float crowdedDistance = BENCHMARK_CROWDED_FRACTION * flock.GetParams().separateDistance;
+    int crowded = 0;
+    std::vector<int> nearest;
+    for(int i = 0; i < count; i++) {
+        tree.QueryNearest(store.px[i], store.py[i], store.pz[i], 2, nearest);
+        for(int n : nearest) {
+            Vector offset = store.GetPosition(i) - store.GetPosition(n);
+            if(flock.GetOptions().periodic) {
+                offset.x -= BOUND_SIZE * rintf(offset.x / BOUND_SIZE);
+                offset.y -= BOUND_SIZE * rintf(offset.y / BOUND_SIZE);
+                offset.z -= BOUND_SIZE * rintf(offset.z / BOUND_SIZE);
+            }
+            if(n != i && offset.Magnitude() < crowdedDistance) {
+                crowded++;
+                break;
+            }
+        }
+    }
+    result.crowded = count > 0 ? (double)crowded / count : 0.0;
+}
+
+static BenchmarkResult RunCase(int boids, const Distribution& distribution, const SearchMode& search, const ThreadingMode& threading, int steps, float distance, int slices, int species, unsigned int seed)
+{
+    srand(seed);
+
+    Flock flock;
+
+    search.configure(flock.GetOptions());
+    flock.GetOptions().doubleBuffered = threading.doubleBuffered;
+    flock.GetOptions().threadCount = threading.allThreads ? flock.GetMaxThreadCount() : 1;
+    flock.GetOptions().steeringSlices = slices;
+    if(distance > 0.0f) {
+        flock.GetParams().alignDistance = distance;
+        flock.GetParams().cohereDistance = distance;
+    }
+    flock.SetSpeciesCount(species);
+    SpeciesMatrix& interaction = flock.GetInteraction();
+    for(int row = 0; row < species; row++) {
+        for(int column = 0; column < species; column++) {
+            if(row != column) {
+                interaction.separate[row][column] = BENCHMARK_CROSS_SEPARATE;
+                interaction.align[row][column] = BENCHMARK_CROSS_ALIGN;
+                interaction.cohere[row][column] = BENCHMARK_CROSS_COHERE;
+            }
+        }
+    }
+    flock.Init(boids);
+    flock.SetViewer(BENCHMARK_VIEWER);
+    distribution.place(flock.GetStore());
+
+    for(int i = 0; i < BENCHMARK_WARMUP_STEPS; i++)
+        flock.Step();
+
+    // time every step on its own so the tail shows up in p99
+    std::vector<double> samples;
+    double indexMs = 0.0, candidates = 0.0, lines = 0.0, misses = 0.0, separationTests = 0.0, separationPairs = 0.0;
+    for(int i = 0; i < steps; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        flock.Step();
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / boids);
+        indexMs += flock.GetStats().indexMs;
+        candidates += (double)flock.GetStats().neighborCandidates;
+        lines += (double)flock.GetStats().neighborLines;
+        separationTests += (double)flock.GetStats().separationTests;
+        separationPairs += (double)flock.GetStats().separationPairs;
+        misses = flock.GetStats().cacheMisses >= 0 ? misses + flock.GetStats().cacheMisses : -1.0;
+    }
+
+    BenchmarkResult result;
+    result.boids = boids;
+    result.distribution = distribution.name;
+    result.search = search.name;
+    result.threading = threading.name;
+    result.threads = threading.doubleBuffered ? std::min(flock.GetOptions().threadCount, flock.GetMaxThreadCount()) : 1;
+    result.steps = steps;
+    result.distance = flock.GetParams().GetNeighborDistance();
+    result.slices = slices;
+    result.species = species;
+    result.mean = 0.0;
+    for(double sample : samples)
+        result.mean += sample / samples.size();
+    result.median = Percentile(samples, 0.5);
+    result.p99 = Percentile(samples, 0.99);
+    result.indexMs = indexMs / steps;
+    result.neighborCandidates = candidates / steps;
+    result.neighborLines = lines / steps;
+    result.separationTests = separationTests / steps;
+    result.separationPairs = separationPairs / steps;
+    result.cacheMisses = misses >= 0.0 ? misses / steps : -1.0;
+    MeasureStability(flock, result);
+    return result;
+}
+
+#pragma endregion
+
+#pragma region output
+
+// neighbor candidates are what the search hands to steering, in place rows search a radius padded by the top speed
+static void WriteJson(std::ostream& out, const std::vector<BenchmarkResult>& results, unsigned int seed)
+{
+    out << std::fixed << std::setprecision(3);
+    out << "{" << std::endl;
+    out << "  \"seed\": " << seed << "," << std::endl;
+    out << "  \"kernel\": \"" << GetSimdLevelName(GetSupportedSimdLevel()) << "\"," << std::endl;
+    out << "  \"hardware_threads\": " << ThreadPool::GetHardwareThreadCount() << "," << std::endl;
+    out << "  \"results\": [" << std::endl;
+    for(size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& r = results[i];
+        out << "    { \"boids\": " << r.boids
+            << ", \"distribution\": \"" << r.distribution << "\""
+            << ", \"search\": \"" << r.search << "\""
+            << ", \"threading\": \"" << r.threading << "\""
+            << ", \"threads\": " << r.threads
+            << ", \"steps\": " << r.steps
+            << ", \"neighbor_distance\": " << r.distance
+            << ", \"steering_slices\": " << r.slices
+            << ", \"species\": " << r.species
+            << ", \"ns_per_boid_step\": { \"mean\": " << r.mean << ", \"median\": " << r.median << ", \"p99\": " << r.p99 << " }"
+            << ", \"index_ms_per_step\": " << r.indexMs
+            << std::setprecision(0)
+            << ", \"neighbor_candidates_per_step\": " << r.neighborCandidates
+            << ", \"neighbor_lines_per_step\": " << r.neighborLines
+            << ", \"separation_tests_per_step\": " << r.separationTests
+            << ", \"separation_pairs_per_step\": " << r.separationPairs
+            << ", \"cache_misses_per_step\": " << r.cacheMisses
+            << std::setprecision(3)
+            << ", \"polarization\": " << r.polarization
+            << ", \"crowded_fraction\": " << r.crowded
+            << " }" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+}
+
+#pragma endregion
+
+int main(int argc, char **argv)
+{
+    std::vector<int> sizes = { 1000, 10000, 100000, 1000000 };
+    int fixedSteps = 0;
+    float distance = 0.0f;
+    int slices = 1;
+    int species = 1;
+    unsigned int seed = 1;
+    const char *outPath = nullptr;
+    std::string searchFilter;
+
+    // parse arguments
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            sizes.clear();
+            std::stringstream list(argv[++i]);
+            std::string size;
+            while(std::getline(list, size, ','))
+                sizes.push_back(atoi(size.c_str()));
+        } else if(strcmp(argv[i], "--search") == 0 && i + 1 < argc) {
+            searchFilter = std::string(",") + argv[++i] + ",";
+        } else if(strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            fixedSteps = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--distance") == 0 && i + 1 < argc) {
+            distance = (float)atof(argv[++i]);
+        } else if(strcmp(argv[i], "--slices") == 0 && i + 1 < argc) {
+            slices = std::max(atoi(argv[++i]), 1);
+        } else if(strcmp(argv[i], "--species") == 0 && i + 1 < argc) {
+            species = Clamp(atoi(argv[++i]), 1, SPECIES_MAX);
+        } else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+    }
+
+    std::vector<BenchmarkResult> results;
+    for(int boids : sizes) {
+        // fewer steps for big flocks so the whole suite stays bounded
+        int steps = fixedSteps > 0 ? fixedSteps : Clamp(100000 / std::max(boids, 1), 3, 50);
+
+        for(const Distribution& distribution : s_Distributions) {
+            for(const SearchMode& search : s_SearchModes) {
+                if(!searchFilter.empty() && searchFilter.find(std::string(",") + search.name + ",") == std::string::npos)
+                    continue;
+                if(boids > search.maxBoids) {
+                    std::cerr << "BENCHMARK: skipping " << search.name << " at " << boids << " boids" << std::endl;
+                    continue;
+                }
+                for(const ThreadingMode& threading : s_ThreadingModes) {
+                    std::cerr << "BENCHMARK: " << boids << " boids, " << distribution.name << ", " << search.name << ", " << threading.name << std::endl;
+                    results.push_back(RunCase(boids, distribution, search, threading, steps, distance, slices, species, seed));
+                }
+            }
+        }
+    }
+
+    if(outPath != nullptr) {
+        std::ofstream file(outPath);
+        WriteJson(file, results, seed);
+    } else {
+        WriteJson(std::cout, results, seed);
+    }
+
+    return 0;
+}
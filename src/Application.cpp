@@ -5,6 +5,7 @@
 
 #include <glad/glad.h>
 #include <iostream>
+#include <cmath>
 
 #define WIN_W 1280
 #define WIN_H 720
@@ -42,7 +43,7 @@ Window::Window(int width, int height, const char *title)
     }
     glfwMakeContextCurrent(m_Window);
     glfwSetWindowSizeLimits(m_Window, WIN_W_MIN, WIN_H_MIN, WIN_W_MAX, WIN_H_MAX);
-    glfwSwapInterval(1);
+    SetVSync(true);
 
     // load glad
     if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -93,6 +94,11 @@ bool Window::WindowShouldClose(void)
     return glfwWindowShouldClose(m_Window);
 }
 
+void Window::SetVSync(bool enabled)
+{
+    glfwSwapInterval(enabled ? 1 : 0);
+}
+
 int Window::GetWidth(void) const { return m_Width; }
 int Window::GetHeight(void) const { return m_Height; }
 float Window::GetAspect(void) const { return (float)m_Width / (float)m_Height; }
@@ -135,13 +141,40 @@ void Application::Run(void)
     bool show_another_window = false;
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
+    m_Renderer.Init();
     OnInit();
+
+    double previousTime = glfwGetTime();
+    double accumulator = 0.0;
+    bool vsync = m_VSync;
+
     while(!m_Window->WindowShouldClose()) {
         m_Input.PollEvents();
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
+
+        if(vsync != m_VSync) {
+            vsync = m_VSync;
+            m_Window->SetVSync(vsync);
+        }
+
+        // fixed step update, drop the backlog once a frame hits the substep limit
+        double tickLength = 1.0 / m_TickRate;
+        double currentTime = glfwGetTime();
+        accumulator += currentTime - previousTime;
+        previousTime = currentTime;
+
+        m_TicksThisFrame = 0;
+        while(accumulator >= tickLength && m_TicksThisFrame < m_MaxSubsteps) {
+            OnFixedUpdate();
+            accumulator -= tickLength;
+            m_TicksThisFrame++;
+        }
+        if(accumulator >= tickLength)
+            accumulator = fmod(accumulator, tickLength);
+        m_TickInterpolation = (float)(accumulator / tickLength);
         
         // update
         OnUpdate();
@@ -164,7 +197,13 @@ Window *Application::GetWindow(void)
     return m_Window;
 }
 
+float Application::GetTickInterpolation(void) const
+{
+    return m_TickInterpolation;
+}
+
 void Application::OnInit(void) {}
+void Application::OnFixedUpdate(void) {}
 void Application::OnUpdate(void) {}
 void Application::OnRender(void) {}
 void Application::OnGUIRender(void) {}
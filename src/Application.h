@@ -17,6 +17,7 @@ public:
 
     void SwapBuffers(void);
     bool WindowShouldClose(void);
+    void SetVSync(bool enabled);
 
     int GetWidth(void) const;
     int GetHeight(void) const;
@@ -45,9 +46,11 @@ public:
     void Run(void);
 
     Window *GetWindow(void);
+    float GetTickInterpolation(void) const;
 
 protected:
     virtual void OnInit(void);
+    virtual void OnFixedUpdate(void);
     virtual void OnUpdate(void);
     virtual void OnRender(void);
     virtual void OnGUIRender(void);
@@ -58,6 +61,13 @@ protected:
     Renderer m_Renderer;
     Input m_Input;
 
+    // fixed step simulation, rendering interpolates between the last two ticks
+    float m_TickRate = 60.0f;
+    int m_MaxSubsteps = 4;
+    int m_TicksThisFrame = 0;
+    float m_TickInterpolation = 1.0f;
+    bool m_VSync = true;
+
 private:
     friend class Window;
 };
\ No newline at end of file
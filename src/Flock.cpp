@@ -0,0 +1,2194 @@
+#include "Flock.h"
+
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+
+#pragma region flock_store
+
+FlockStore::FlockStore(void) {}
+
+FlockStore::~FlockStore() {}
+
+void FlockStore::Resize(int count)
+{
+    // grow geometrically so repeated spawns don't reallocate every call
+    // lanes are checked one by one since swapping with another store can leave them at different capacities
+    AlignedArray<float> *lanes[] = { &px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz, &ax, &ay, &az, &sx, &sy, &sz, &ppx, &ppy, &ppz };
+    for(AlignedArray<float> *lane : lanes) {
+        if(count > lane->GetCapacity())
+            lane->Reserve(std::max(count, lane->GetCapacity() * 2));
+    }
+    if(count > species.GetCapacity())
+        species.Reserve(std::max(count, species.GetCapacity() * 2));
+
+    m_Count = count;
+}
+
+int FlockStore::Add(void)
+{
+    Resize(m_Count + 1);
+    return m_Count - 1;
+}
+
+void FlockStore::Remove(int index)
+{
+    int last = m_Count - 1;
+    if(index != last) {
+        AlignedArray<float> *lanes[] = { &px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz, &ax, &ay, &az, &sx, &sy, &sz, &ppx, &ppy, &ppz };
+        for(AlignedArray<float> *lane : lanes)
+            (*lane)[index] = (*lane)[last];
+        species[index] = species[last];
+    }
+
+    m_Count = last;
+}
+
+int FlockStore::GetCount(void) const
+{
+    return m_Count;
+}
+
+int FlockStore::GetCapacity(void) const
+{
+    return px.GetCapacity();
+}
+
+Point FlockStore::GetPosition(int index) const
+{
+    return Point(px[index], py[index], pz[index]);
+}
+
+Vector FlockStore::GetVelocity(int index) const
+{
+    return Vector(vx[index], vy[index], vz[index]);
+}
+
+Vector FlockStore::GetForward(int index) const
+{
+    return Vector(fx[index], fy[index], fz[index]);
+}
+
+void FlockStore::SetPosition(int index, const Point& position)
+{
+    px[index] = position.x;
+    py[index] = position.y;
+    pz[index] = position.z;
+}
+
+void FlockStore::SetVelocity(int index, const Vector& velocity)
+{
+    vx[index] = velocity.x;
+    vy[index] = velocity.y;
+    vz[index] = velocity.z;
+}
+
+void FlockStore::SwapKinematics(FlockStore& other)
+{
+    // acceleration is per-step scratch and stays with this store
+    AlignedArray<float> *lanes[] = { &px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz };
+    AlignedArray<float> *otherLanes[] = { &other.px, &other.py, &other.pz, &other.vx, &other.vy, &other.vz, &other.fx, &other.fy, &other.fz };
+    for(int i = 0; i < 9; i++)
+        lanes[i]->Swap(*otherLanes[i]);
+}
+
+void FlockStore::Reorder(const std::vector<int>& order, FlockStore& scratch)
+{
+    // gather every lane into the scratch store in the new order, then take its lanes
+    scratch.Resize(m_Count);
+    AlignedArray<float> *lanes[] = { &px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz, &ax, &ay, &az, &sx, &sy, &sz, &ppx, &ppy, &ppz };
+    AlignedArray<float> *scratchLanes[] = { &scratch.px, &scratch.py, &scratch.pz, &scratch.vx, &scratch.vy, &scratch.vz, &scratch.fx, &scratch.fy, &scratch.fz, &scratch.ax, &scratch.ay, &scratch.az, &scratch.sx, &scratch.sy, &scratch.sz, &scratch.ppx, &scratch.ppy, &scratch.ppz };
+    for(int l = 0; l < 18; l++) {
+        const float *source = lanes[l]->GetData();
+        float *target = scratchLanes[l]->GetData();
+        for(int i = 0; i < m_Count; i++)
+            target[i] = source[order[i]];
+        lanes[l]->Swap(*scratchLanes[l]);
+    }
+
+    for(int i = 0; i < m_Count; i++)
+        scratch.species[i] = species[order[i]];
+    species.Swap(scratch.species);
+}
+
+void FlockStore::SavePreviousPositions(void)
+{
+    std::copy(px.GetData(), px.GetData() + m_Count, ppx.GetData());
+    std::copy(py.GetData(), py.GetData() + m_Count, ppy.GetData());
+    std::copy(pz.GetData(), pz.GetData() + m_Count, ppz.GetData());
+}
+
+Point FlockStore::GetInterpolatedPosition(int index, float t) const
+{
+    return Flock::Interpolate(Point(ppx[index], ppy[index], ppz[index]), GetPosition(index), t);
+}
+
+#pragma endregion
+
+#pragma region spatial_grid
+
+static unsigned int SpreadBits(unsigned int value)
+{
+    // interleave the low 10 bits with two zero bits each
+    value &= 0x3ff;
+    value = (value | (value << 16)) & 0x030000ff;
+    value = (value | (value << 8)) & 0x0300f00f;
+    value = (value | (value << 4)) & 0x030c30c3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+SpatialGrid::SpatialGrid(void) {}
+
+SpatialGrid::~SpatialGrid() {}
+
+void SpatialGrid::Build(const FlockStore& store, float cellSize, bool periodic, ThreadPool& pool, int threadCount)
+{
+    BuildCells(store, cellSize, periodic, pool, threadCount, false);
+}
+
+void SpatialGrid::Update(const FlockStore& store, float cellSize, bool periodic, ThreadPool& pool, int threadCount)
+{
+    int count = store.GetCount();
+    if(!m_Slack || CellResolution(cellSize) != m_Resolution || periodic != m_Periodic || count != (int)m_BoidCells.size()) {
+        BuildCells(store, cellSize, periodic, pool, threadCount, true);
+        return;
+    }
+
+    // keys in parallel, the moves themselves are few and stay serial
+    m_NextCells.resize(count);
+    pool.ParallelFor(count, threadCount, [this, &store](int begin, int end, int) {
+        for(int i = begin; i < end; i++)
+            m_NextCells[i] = BoidCell(store, i);
+    });
+
+    m_Rebuilt = false;
+    m_Moved = 0;
+    for(int i = 0; i < count; i++) {
+        int cell = m_NextCells[i];
+        int previous = m_BoidCells[i];
+        if(cell == previous)
+            continue;
+
+        if(m_CellEnd[cell] == m_CellStart[cell + 1]) {
+            BuildCells(store, cellSize, periodic, pool, threadCount, true);
+            return;
+        }
+
+        // the last boid of the old cell fills the hole
+        int last = m_CellBoids[--m_CellEnd[previous]];
+        m_CellBoids[m_BoidSlots[i]] = last;
+        m_BoidSlots[last] = m_BoidSlots[i];
+
+        m_BoidSlots[i] = m_CellEnd[cell]++;
+        m_CellBoids[m_BoidSlots[i]] = i;
+        m_BoidCells[i] = cell;
+        m_Moved++;
+    }
+}
+
+void SpatialGrid::BuildAggregates(const FlockStore& store)
+{
+    m_CellAggregates.assign(m_CellEnd.size(), CellAggregate());
+    for(int i = 0; i < store.GetCount(); i++) {
+        CellAggregate& aggregate = m_CellAggregates[m_BoidCells[i]];
+        aggregate.px += store.px[i];
+        aggregate.py += store.py[i];
+        aggregate.pz += store.pz[i];
+        aggregate.fx += store.fx[i];
+        aggregate.fy += store.fy[i];
+        aggregate.fz += store.fz[i];
+    }
+}
+
+void SpatialGrid::Remap(const std::vector<int>& remap)
+{
+    // a grid over another count is stale anyway and gets rebuilt by the next update
+    if(remap.size() != m_BoidCells.size()) {
+        Invalidate();
+        return;
+    }
+
+    // cells keep their slots, only the indices stored in them change
+    for(int slot = 0; slot < (int)m_CellBoids.size(); slot++)
+        m_CellBoids[slot] = remap[m_CellBoids[slot]];
+    m_NextCells.resize(m_BoidCells.size());
+    for(int i = 0; i < (int)m_BoidCells.size(); i++)
+        m_NextCells[remap[i]] = m_BoidCells[i];
+    m_BoidCells.swap(m_NextCells);
+    for(int c = 0; c < (int)m_CellEnd.size(); c++) {
+        for(int slot = m_CellStart[c]; slot < m_CellEnd[c]; slot++)
+            m_BoidSlots[m_CellBoids[slot]] = slot;
+    }
+}
+
+void SpatialGrid::Invalidate(void)
+{
+    m_Slack = false;
+}
+
+void SpatialGrid::Query(float x, float y, float z, std::vector<int>& neighbors) const
+{
+    neighbors.clear();
+
+    int firstX, lastX, firstY, lastY, firstZ, lastZ;
+    CellRange(CellCoord(x), 1, firstX, lastX);
+    CellRange(CellCoord(y), 1, firstY, lastY);
+    CellRange(CellCoord(z), 1, firstZ, lastZ);
+
+    for(int z = firstZ; z <= lastZ; z++) {
+        for(int y = firstY; y <= lastY; y++) {
+            for(int x = firstX; x <= lastX; x++) {
+                // out of range coords only survive on a periodic grid, wrap them to the far face
+                int cell = CellIndex((x + m_Resolution) % m_Resolution, (y + m_Resolution) % m_Resolution, (z + m_Resolution) % m_Resolution);
+                neighbors.insert(neighbors.end(), m_CellBoids.begin() + m_CellStart[cell], m_CellBoids.begin() + m_CellEnd[cell]);
+            }
+        }
+    }
+}
+
+void SpatialGrid::QueryRadius(float x, float y, float z, float radius, std::vector<int>& neighbors) const
+{
+    // no cell is ever summed without a far distance
+    NeighborSums far;
+    QueryAggregated(x, y, z, radius, 0.0f, 0.0f, neighbors, far);
+}
+
+void SpatialGrid::QueryAggregated(float x, float y, float z, float radius, float nearDistance, float farDistance,
+    std::vector<int>& neighbors, NeighborSums& far) const
+{
+    neighbors.clear();
+
+    // a summed cell has to be the nearest image for every boid in it, which holds inside half the bound
+    if(m_Periodic)
+        farDistance = std::min(farDistance, BOUND_SIZE * 0.49f);
+    float radiusSq = radius * radius;
+    float nearSq = nearDistance * nearDistance;
+    float farSq = farDistance > 0.0f ? farDistance * farDistance : -1.0f;
+
+    int reach = (int)ceilf(radius / m_CellSize);
+    AxisCells axisX, axisY, axisZ;
+    GetAxisCells(x, reach, axisX);
+    GetAxisCells(y, reach, axisY);
+    GetAxisCells(z, reach, axisZ);
+
+    for(int k = 0; k < axisZ.count; k++) {
+        for(int j = 0; j < axisY.count; j++) {
+            float minYZ = axisZ.minSq[k] + axisY.minSq[j];
+            if(minYZ > radiusSq)
+                continue;
+
+            for(int i = 0; i < axisX.count; i++) {
+                float minSq = minYZ + axisX.minSq[i];
+                if(minSq > radiusSq)
+                    continue;
+
+                int cell = CellIndex(axisX.cells[i], axisY.cells[j], axisZ.cells[k]);
+                int begin = m_CellStart[cell], end = m_CellEnd[cell];
+                if(begin == end)
+                    continue;
+
+                // boundary cells and cells close enough to separate from are scanned boid by boid
+                float maxSq = axisZ.maxSq[k] + axisY.maxSq[j] + axisX.maxSq[i];
+                if(maxSq > farSq || minSq <= nearSq) {
+                    neighbors.insert(neighbors.end(), m_CellBoids.begin() + begin, m_CellBoids.begin() + end);
+                    continue;
+                }
+
+                const CellAggregate& aggregate = m_CellAggregates[cell];
+                int count = end - begin;
+                far.forwardX += aggregate.fx;
+                far.forwardY += aggregate.fy;
+                far.forwardZ += aggregate.fz;
+                far.centerX += aggregate.px + count * axisX.shift[i];
+                far.centerY += aggregate.py + count * axisY.shift[j];
+                far.centerZ += aggregate.pz + count * axisZ.shift[k];
+                far.cohereWeight += count;
+            }
+        }
+    }
+}
+
+void SpatialGrid::BuildBlocks(void)
+{
+    m_BlockMarks.resize(GetCellCount(), 0);
+    m_BlockWindows.clear();
+
+    // a boid's cell lies in the 8 windows whose lowest cell is at most one below it on every axis
+    for(int i = 0; i < (int)m_BoidCells.size(); i++) {
+        int cell = m_BoidCells[i];
+        int x = cell % m_Resolution;
+        int y = cell / m_Resolution % m_Resolution;
+        int z = cell / (m_Resolution * m_Resolution);
+        for(int k = 0; k < 8; k++) {
+            int wx = x - (k & 1), wy = y - (k >> 1 & 1), wz = z - (k >> 2);
+            if(m_Periodic) {
+                wx = (wx + m_Resolution) % m_Resolution;
+                wy = (wy + m_Resolution) % m_Resolution;
+                wz = (wz + m_Resolution) % m_Resolution;
+            } else if(wx < 0 || wy < 0 || wz < 0) {
+                continue;
+            }
+
+            int window = CellIndex(wx, wy, wz);
+            if(!m_BlockMarks[window]) {
+                m_BlockMarks[window] = 1;
+                m_BlockWindows.push_back(window);
+            }
+        }
+    }
+
+    // counting sort by color, clearing the marks on the way
+    m_ColorStarts.assign(GRID_BLOCK_COLORS + 1, 0);
+    for(int b = 0; b < (int)m_BlockWindows.size(); b++) {
+        m_BlockMarks[m_BlockWindows[b]] = 0;
+        m_ColorStarts[BlockColor(m_BlockWindows[b]) + 1]++;
+    }
+    for(int c = 0; c < GRID_BLOCK_COLORS; c++)
+        m_ColorStarts[c + 1] += m_ColorStarts[c];
+
+    int cursor[GRID_BLOCK_COLORS];
+    std::copy(m_ColorStarts.begin(), m_ColorStarts.end() - 1, cursor);
+    m_Blocks.resize(m_BlockWindows.size());
+    for(int b = 0; b < (int)m_BlockWindows.size(); b++)
+        m_Blocks[cursor[BlockColor(m_BlockWindows[b])]++] = m_BlockWindows[b];
+}
+
+int SpatialGrid::GetBlockColorCount(void) const
+{
+    return GRID_BLOCK_COLORS;
+}
+
+void SpatialGrid::GetBlockRange(int color, int& begin, int& end) const
+{
+    begin = m_ColorStarts[color];
+    end = m_ColorStarts[color + 1];
+}
+
+int SpatialGrid::GetBlockPairs(int block, int pairs[GRID_BLOCK_PAIRS][2]) const
+{
+    // corner k of the window sits one cell up in x for bit 0, in y for bit 1 and in z for bit 2
+    // a pair of corners has the window's lowest cell as its own lowest corner when they share no bit
+    static const int s_Corners[GRID_BLOCK_PAIRS][2] = {
+        { 0, 0 }, { 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 }, { 0, 5 }, { 0, 6 }, { 0, 7 },
+        { 1, 2 }, { 1, 4 }, { 1, 6 }, { 2, 4 }, { 2, 5 }, { 3, 4 }
+    };
+
+    int cell = m_Blocks[block];
+    int x = cell % m_Resolution;
+    int y = cell / m_Resolution % m_Resolution;
+    int z = cell / (m_Resolution * m_Resolution);
+
+    int cells[8];
+    for(int k = 0; k < 8; k++) {
+        int cx = x + (k & 1), cy = y + (k >> 1 & 1), cz = z + (k >> 2);
+        if(m_Periodic) {
+            cx %= m_Resolution;
+            cy %= m_Resolution;
+            cz %= m_Resolution;
+        } else if(cx >= m_Resolution || cy >= m_Resolution || cz >= m_Resolution) {
+            cells[k] = -1;
+            continue;
+        }
+
+        int corner = CellIndex(cx, cy, cz);
+        cells[k] = m_CellStart[corner] == m_CellEnd[corner] ? -1 : corner;
+    }
+
+    int count = 0;
+    for(int p = 0; p < GRID_BLOCK_PAIRS; p++) {
+        int first = cells[s_Corners[p][0]], second = cells[s_Corners[p][1]];
+        if(first < 0 || second < 0)
+            continue;
+        pairs[count][0] = first;
+        pairs[count][1] = second;
+        count++;
+    }
+    return count;
+}
+
+const int *SpatialGrid::GetCellBoids(int cell, int& count) const
+{
+    count = m_CellEnd[cell] - m_CellStart[cell];
+    return m_CellBoids.data() + m_CellStart[cell];
+}
+
+int SpatialGrid::BlockColor(int cell) const
+{
+    // windows of the same parity on every axis are at least two cells apart, so they share no cell
+    // a wrapped odd resolution puts the last coord next to coord 0, so it gets a color of its own
+    int coords[3] = { cell % m_Resolution, cell / m_Resolution % m_Resolution, cell / (m_Resolution * m_Resolution) };
+    int color = 0;
+    for(int axis = 2; axis >= 0; axis--)
+        color = color * 3 + (m_Periodic && (m_Resolution & 1) && coords[axis] == m_Resolution - 1 ? 2 : coords[axis] & 1);
+    return color;
+}
+
+bool SpatialGrid::SupportsHalfShell(void) const
+{
+    // with fewer than 3 wrapped cells an offset and its mirror land on the same cell
+    return !m_Periodic || m_Resolution >= 3;
+}
+
+int SpatialGrid::GetCellCount(void) const
+{
+    return m_Resolution * m_Resolution * m_Resolution;
+}
+
+int SpatialGrid::GetResolution(void) const
+{
+    return m_Resolution;
+}
+
+int SpatialGrid::GetMovedCount(void) const
+{
+    return m_Moved;
+}
+
+bool SpatialGrid::WasRebuilt(void) const
+{
+    return m_Rebuilt;
+}
+
+unsigned int SpatialGrid::GetMortonKey(float x, float y, float z, float cellSize)
+{
+    // same coords as CellCoord on a grid built with this cell size
+    int resolution = CellResolution(cellSize);
+    float size = BOUND_SIZE / resolution;
+    unsigned int cx = Clamp((int)((x + BOUND_SIZE * 0.5f) / size), 0, resolution - 1);
+    unsigned int cy = Clamp((int)((y + BOUND_SIZE * 0.5f) / size), 0, resolution - 1);
+    unsigned int cz = Clamp((int)((z + BOUND_SIZE * 0.5f) / size), 0, resolution - 1);
+    return SpreadBits(cx) | (SpreadBits(cy) << 1) | (SpreadBits(cz) << 2);
+}
+
+int SpatialGrid::CellResolution(float cellSize)
+{
+    // fit a whole number of cells into the bound, never smaller than requested
+    return Clamp((int)(BOUND_SIZE / cellSize), 1, 64);
+}
+
+void SpatialGrid::BuildCells(const FlockStore& store, float cellSize, bool periodic, ThreadPool& pool, int threadCount, bool slack)
+{
+    m_Periodic = periodic;
+    m_Slack = slack;
+    m_Rebuilt = true;
+
+    m_Resolution = CellResolution(cellSize);
+    m_CellSize = BOUND_SIZE / m_Resolution;
+
+    int count = store.GetCount();
+    int cellCount = m_Resolution * m_Resolution * m_Resolution;
+    m_CellStart.assign(cellCount + 1, 0);
+    m_CellEnd.resize(cellCount);
+    m_BoidCells.resize(count);
+    m_BoidSlots.resize(count);
+    m_Moved = count;
+
+    // count boids per cell, threads share the counters so the totals don't depend on the split
+    if(threadCount > 1) {
+        if((int)m_CellCursors.size() != cellCount)
+            m_CellCursors = std::vector<std::atomic<int>>(cellCount);
+        for(std::atomic<int>& cursor : m_CellCursors)
+            cursor.store(0, std::memory_order_relaxed);
+
+        pool.ParallelFor(count, threadCount, [this, &store](int begin, int end, int) {
+            for(int i = begin; i < end; i++) {
+                m_BoidCells[i] = BoidCell(store, i);
+                m_CellCursors[m_BoidCells[i]].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        for(int c = 0; c < cellCount; c++)
+            m_CellStart[c + 1] = m_CellCursors[c].load(std::memory_order_relaxed);
+    } else {
+        for(int i = 0; i < count; i++) {
+            m_BoidCells[i] = BoidCell(store, i);
+            m_CellStart[m_BoidCells[i] + 1]++;
+        }
+    }
+
+    // prefix sum into cell offsets, leaving free slots behind each cell when it's updated incrementally
+    for(int c = 0; c < cellCount; c++) {
+        int cellBoids = m_CellStart[c + 1];
+        m_CellEnd[c] = m_CellStart[c] + cellBoids;
+        m_CellStart[c + 1] = m_CellEnd[c] + (slack ? cellBoids / 4 + GRID_CELL_SLACK : 0);
+    }
+    m_CellBoids.resize(m_CellStart[cellCount]);
+
+    if(threadCount <= 1) {
+        // scatter boid indices into their cell ranges
+        std::vector<int> cursor(m_CellStart.begin(), m_CellStart.end() - 1);
+        for(int i = 0; i < count; i++) {
+            m_BoidSlots[i] = cursor[m_BoidCells[i]]++;
+            m_CellBoids[m_BoidSlots[i]] = i;
+        }
+        return;
+    }
+
+    // scatter in parallel, then sort every cell so it lists its boids in the same order as the serial build
+    for(int c = 0; c < cellCount; c++)
+        m_CellCursors[c].store(m_CellStart[c], std::memory_order_relaxed);
+    pool.ParallelFor(count, threadCount, [this](int begin, int end, int) {
+        for(int i = begin; i < end; i++)
+            m_CellBoids[m_CellCursors[m_BoidCells[i]].fetch_add(1, std::memory_order_relaxed)] = i;
+    });
+    pool.ParallelFor(cellCount, threadCount, [this](int begin, int end, int) {
+        for(int c = begin; c < end; c++) {
+            std::sort(m_CellBoids.begin() + m_CellStart[c], m_CellBoids.begin() + m_CellEnd[c]);
+            for(int slot = m_CellStart[c]; slot < m_CellEnd[c]; slot++)
+                m_BoidSlots[m_CellBoids[slot]] = slot;
+        }
+    });
+}
+
+int SpatialGrid::BoidCell(const FlockStore& store, int index) const
+{
+    return CellIndex(CellCoord(store.px[index]), CellCoord(store.py[index]), CellCoord(store.pz[index]));
+}
+
+int SpatialGrid::CellCoord(float value) const
+{
+    return Clamp((int)((value + BOUND_SIZE * 0.5f) / m_CellSize), 0, m_Resolution - 1);
+}
+
+int SpatialGrid::CellIndex(int x, int y, int z) const
+{
+    return (z * m_Resolution + y) * m_Resolution + x;
+}
+
+void SpatialGrid::CellRange(int coord, int reach, int& first, int& last) const
+{
+    // a reach past the grid width adds nothing, every axis cell is already in range
+    reach = std::min(reach, m_Resolution);
+
+    if(!m_Periodic) {
+        first = std::max(coord - reach, 0);
+        last = std::min(coord + reach, m_Resolution - 1);
+        return;
+    }
+
+    // with fewer than 2 * reach + 1 cells per axis the wrapped range would visit a cell twice, so it stops after one lap
+    first = coord - reach;
+    last = std::min(coord + reach, first + m_Resolution - 1);
+}
+
+void SpatialGrid::GetAxisCells(float value, int reach, AxisCells& axis) const
+{
+    int first, last;
+    CellRange(CellCoord(value), reach, first, last);
+
+    axis.count = 0;
+    for(int c = first; c <= last; c++) {
+        int cell = (c % m_Resolution + m_Resolution) % m_Resolution;
+        float offset = value - (-BOUND_SIZE * 0.5f + (cell + 0.5f) * m_CellSize);
+
+        // shift moves the cell to its image nearest the value
+        float shift = m_Periodic ? BOUND_SIZE * rintf(offset / BOUND_SIZE) : 0.0f;
+        offset = fabs(offset - shift);
+        float nearest = std::max(offset - m_CellSize * 0.5f, 0.0f);
+        float farthest = offset + m_CellSize * 0.5f;
+
+        axis.cells[axis.count] = cell;
+        axis.minSq[axis.count] = nearest * nearest;
+        axis.maxSq[axis.count] = farthest * farthest;
+        axis.shift[axis.count] = shift;
+        axis.count++;
+    }
+}
+
+#pragma endregion
+
+#pragma region spatial_octree
+
+SpatialOctree::SpatialOctree(void) {}
+
+SpatialOctree::~SpatialOctree() {}
+
+void SpatialOctree::Build(const FlockStore& store, float radius, bool periodic)
+{
+    // leaves much smaller than the query radius only add traversal
+    m_Radius = radius;
+    m_MinHalf = radius * 0.25f;
+    m_Periodic = periodic;
+    m_Valid = true;
+    m_Moved = store.GetCount();
+
+    m_Nodes.resize(1);
+    m_FreeBlocks.clear();
+    Node& root = m_Nodes[0];
+    root.x = root.y = root.z = 0.0f;
+    root.half = BOUND_SIZE * 0.5f;
+    root.children = -1;
+    root.count = 0;
+    root.boids.clear();
+
+    int count = store.GetCount();
+    m_BoidLeaves.resize(count);
+    m_BoidSlots.resize(count);
+    for(int i = 0; i < count; i++)
+        Insert(store, i);
+}
+
+void SpatialOctree::Update(const FlockStore& store, float radius, bool periodic)
+{
+    if(!m_Valid || store.GetCount() != (int)m_BoidLeaves.size() || radius != m_Radius || periodic != m_Periodic) {
+        Build(store, radius, periodic);
+        return;
+    }
+
+    // move boids that left their leaf, most stay put from one step to the next
+    m_Moved = 0;
+    for(int i = 0; i < store.GetCount(); i++) {
+        if(!Contains(m_BoidLeaves[i], store.px[i], store.py[i], store.pz[i])) {
+            Remove(i);
+            Insert(store, i);
+            m_Moved++;
+        }
+    }
+
+    Collapse(0);
+}
+
+void SpatialOctree::Invalidate(void)
+{
+    m_Valid = false;
+}
+
+void SpatialOctree::Query(float x, float y, float z, std::vector<int>& neighbors) const
+{
+    neighbors.clear();
+
+    // depth first, every level pushes at most 8 children
+    int stack[8 * (OCTREE_MAX_DEPTH + 1)];
+    int top = 0;
+    stack[top++] = 0;
+
+    while(top > 0) {
+        int index = stack[--top];
+        const Node& node = m_Nodes[index];
+
+        if(node.children < 0) {
+            neighbors.insert(neighbors.end(), node.boids.begin(), node.boids.end());
+            continue;
+        }
+
+        for(int c = 0; c < 8; c++) {
+            int child = node.children + c;
+            if(m_Nodes[child].count > 0 && Overlaps(child, x, y, z))
+                stack[top++] = child;
+        }
+    }
+}
+
+int SpatialOctree::GetNodeCount(void) const
+{
+    return (int)m_Nodes.size() - 8 * (int)m_FreeBlocks.size();
+}
+
+int SpatialOctree::GetLeafCount(void) const
+{
+    // every split turns one leaf into 8
+    return 1 + 7 * (GetNodeCount() - 1) / 8;
+}
+
+int SpatialOctree::GetMovedCount(void) const
+{
+    return m_Moved;
+}
+
+int SpatialOctree::AllocateChildren(int node)
+{
+    int block;
+    if(!m_FreeBlocks.empty()) {
+        block = m_FreeBlocks.back();
+        m_FreeBlocks.pop_back();
+    } else {
+        block = (int)m_Nodes.size();
+        m_Nodes.resize(m_Nodes.size() + 8);
+    }
+
+    const Node& parent = m_Nodes[node];
+    float half = parent.half * 0.5f;
+    for(int c = 0; c < 8; c++) {
+        Node& child = m_Nodes[block + c];
+        child.x = parent.x + (c & 1 ? half : -half);
+        child.y = parent.y + (c & 2 ? half : -half);
+        child.z = parent.z + (c & 4 ? half : -half);
+        child.half = half;
+        child.parent = node;
+        child.depth = parent.depth + 1;
+        child.children = -1;
+        child.count = 0;
+        child.boids.clear();
+    }
+
+    m_Nodes[node].children = block;
+    return block;
+}
+
+void SpatialOctree::FreeChildren(int node)
+{
+    int block = m_Nodes[node].children;
+    for(int c = 0; c < 8; c++) {
+        if(m_Nodes[block + c].children >= 0)
+            FreeChildren(block + c);
+    }
+
+    m_FreeBlocks.push_back(block);
+    m_Nodes[node].children = -1;
+}
+
+int SpatialOctree::FindLeaf(float x, float y, float z) const
+{
+    int index = 0;
+    while(m_Nodes[index].children >= 0) {
+        const Node& node = m_Nodes[index];
+        index = node.children + (x >= node.x ? 1 : 0) + (y >= node.y ? 2 : 0) + (z >= node.z ? 4 : 0);
+    }
+    return index;
+}
+
+bool SpatialOctree::Contains(int node, float x, float y, float z) const
+{
+    // the root takes everything, boids sit on the bound faces after mirroring
+    if(node == 0)
+        return true;
+
+    // faces on the world bound are open, FindLeaf files everything on or past them into the edge leaf
+    const Node& n = m_Nodes[node];
+    float bound = BOUND_SIZE * 0.5f;
+    return ContainsAxis(x, n.x - n.half, n.x + n.half, bound)
+        && ContainsAxis(y, n.y - n.half, n.y + n.half, bound)
+        && ContainsAxis(z, n.z - n.half, n.z + n.half, bound);
+}
+
+bool SpatialOctree::ContainsAxis(float value, float min, float max, float bound)
+{
+    return (value >= min || min <= -bound) && (value < max || max >= bound);
+}
+
+bool SpatialOctree::Overlaps(int node, float x, float y, float z) const
+{
+    const Node& n = m_Nodes[node];
+    float offsets[] = { fabsf(x - n.x), fabsf(y - n.y), fabsf(z - n.z) };
+    for(float offset : offsets) {
+        // nearest image of the node on a periodic bound
+        if(m_Periodic)
+            offset = std::min(offset, BOUND_SIZE - offset);
+        if(offset > n.half + m_Radius)
+            return false;
+    }
+    return true;
+}
+
+void SpatialOctree::Insert(const FlockStore& store, int boid)
+{
+    int leaf = FindLeaf(store.px[boid], store.py[boid], store.pz[boid]);
+    for(int n = leaf; n >= 0; n = m_Nodes[n].parent)
+        m_Nodes[n].count++;
+
+    Node& node = m_Nodes[leaf];
+    m_BoidLeaves[boid] = leaf;
+    m_BoidSlots[boid] = (int)node.boids.size();
+    node.boids.push_back(boid);
+
+    if(node.boids.size() > OCTREE_LEAF_CAPACITY && node.half * 0.5f >= m_MinHalf && node.depth < OCTREE_MAX_DEPTH)
+        Split(store, leaf);
+}
+
+void SpatialOctree::Remove(int boid)
+{
+    int leaf = m_BoidLeaves[boid];
+    for(int n = leaf; n >= 0; n = m_Nodes[n].parent)
+        m_Nodes[n].count--;
+
+    // move the last boid of the leaf into the hole
+    std::vector<int>& boids = m_Nodes[leaf].boids;
+    int last = boids.back();
+    boids[m_BoidSlots[boid]] = last;
+    m_BoidSlots[last] = m_BoidSlots[boid];
+    boids.pop_back();
+}
+
+void SpatialOctree::Split(const FlockStore& store, int node)
+{
+    int block = AllocateChildren(node);
+
+    // hand the boids down, children that are still over capacity split again
+    std::vector<int> boids;
+    boids.swap(m_Nodes[node].boids);
+    for(int boid : boids) {
+        int child = block + (store.px[boid] >= m_Nodes[node].x ? 1 : 0) + (store.py[boid] >= m_Nodes[node].y ? 2 : 0) + (store.pz[boid] >= m_Nodes[node].z ? 4 : 0);
+        m_BoidLeaves[boid] = child;
+        m_BoidSlots[boid] = (int)m_Nodes[child].boids.size();
+        m_Nodes[child].boids.push_back(boid);
+        m_Nodes[child].count++;
+    }
+
+    for(int c = 0; c < 8; c++) {
+        const Node& child = m_Nodes[block + c];
+        if(child.boids.size() > OCTREE_LEAF_CAPACITY && child.half * 0.5f >= m_MinHalf && child.depth < OCTREE_MAX_DEPTH)
+            Split(store, block + c);
+    }
+}
+
+void SpatialOctree::Collapse(int node)
+{
+    if(m_Nodes[node].children < 0)
+        return;
+
+    if(m_Nodes[node].count > OCTREE_LEAF_CAPACITY / 2) {
+        for(int c = 0; c < 8; c++)
+            Collapse(m_Nodes[node].children + c);
+        return;
+    }
+
+    // few enough boids left to fold the whole subtree back into one leaf
+    std::vector<int> boids;
+    Gather(node, boids);
+    FreeChildren(node);
+
+    for(int i = 0; i < (int)boids.size(); i++) {
+        m_BoidLeaves[boids[i]] = node;
+        m_BoidSlots[boids[i]] = i;
+    }
+    m_Nodes[node].boids.swap(boids);
+}
+
+void SpatialOctree::Gather(int node, std::vector<int>& boids)
+{
+    const Node& n = m_Nodes[node];
+    if(n.children < 0) {
+        boids.insert(boids.end(), n.boids.begin(), n.boids.end());
+        return;
+    }
+
+    for(int c = 0; c < 8; c++)
+        Gather(n.children + c, boids);
+}
+
+#pragma endregion
+
+#pragma region kd_tree
+
+KdTree::KdTree(void) {}
+
+KdTree::~KdTree() {}
+
+void KdTree::Build(const FlockStore& store, bool periodic)
+{
+    m_Store = &store;
+    m_Periodic = periodic;
+
+    int count = store.GetCount();
+    m_Indices.resize(count);
+    for(int i = 0; i < count; i++)
+        m_Indices[i] = i;
+
+    m_Nodes.resize(1);
+    BuildNode(0, 0, count);
+}
+
+void KdTree::QueryNearest(float x, float y, float z, int count, std::vector<int>& neighbors) const
+{
+    neighbors.clear();
+    if(m_Nodes.empty() || count <= 0)
+        return;
+
+    // best candidates so far, kept sorted nearest first
+    count = std::min(count, KNN_MAX + 1);
+    float bestDistances[KNN_MAX + 1];
+    int bestIndices[KNN_MAX + 1];
+    int found = 0;
+
+    const float point[] = { x, y, z };
+    float half = m_Periodic ? BOUND_SIZE * 0.5f : FLT_MAX;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while(top > 0) {
+        const Node& node = m_Nodes[stack[--top]];
+        if(found == count && BoxDistanceSq(node, point) > bestDistances[count - 1])
+            continue;
+
+        if(node.left < 0) {
+            for(int n = node.begin; n < node.end; n++) {
+                int i = m_Indices[n];
+                float dx = x - m_Store->px[i], dy = y - m_Store->py[i], dz = z - m_Store->pz[i];
+                dx = dx > half ? dx - BOUND_SIZE : (dx < -half ? dx + BOUND_SIZE : dx);
+                dy = dy > half ? dy - BOUND_SIZE : (dy < -half ? dy + BOUND_SIZE : dy);
+                dz = dz > half ? dz - BOUND_SIZE : (dz < -half ? dz + BOUND_SIZE : dz);
+                float distanceSq = dx * dx + dy * dy + dz * dz;
+                if(found == count && distanceSq >= bestDistances[count - 1])
+                    continue;
+
+                // insertion into the sorted candidates, dropping the farthest when full
+                int slot = found < count ? found++ : count - 1;
+                while(slot > 0 && bestDistances[slot - 1] > distanceSq) {
+                    bestDistances[slot] = bestDistances[slot - 1];
+                    bestIndices[slot] = bestIndices[slot - 1];
+                    slot--;
+                }
+                bestDistances[slot] = distanceSq;
+                bestIndices[slot] = i;
+            }
+            continue;
+        }
+
+        // push the farther child first so the nearer one is searched first and tightens the bound
+        const Node& left = m_Nodes[node.left];
+        const Node& right = m_Nodes[node.left + 1];
+        if(BoxDistanceSq(left, point) <= BoxDistanceSq(right, point)) {
+            stack[top++] = node.left + 1;
+            stack[top++] = node.left;
+        } else {
+            stack[top++] = node.left;
+            stack[top++] = node.left + 1;
+        }
+    }
+
+    neighbors.assign(bestIndices, bestIndices + found);
+}
+
+int KdTree::GetNodeCount(void) const
+{
+    return (int)m_Nodes.size();
+}
+
+void KdTree::BuildNode(int index, int begin, int end)
+{
+    // tight bounds of the boids under this node
+    const AlignedArray<float> *lanes[] = { &m_Store->px, &m_Store->py, &m_Store->pz };
+    Node node;
+    node.begin = begin;
+    node.end = end;
+    for(int axis = 0; axis < 3; axis++) {
+        node.min[axis] = FLT_MAX;
+        node.max[axis] = -FLT_MAX;
+        for(int n = begin; n < end; n++) {
+            float value = (*lanes[axis])[m_Indices[n]];
+            node.min[axis] = std::min(node.min[axis], value);
+            node.max[axis] = std::max(node.max[axis], value);
+        }
+    }
+
+    if(end - begin > KD_TREE_LEAF_SIZE) {
+        // split at the median of the widest axis
+        int axis = 0;
+        for(int a = 1; a < 3; a++) {
+            if(node.max[a] - node.min[a] > node.max[axis] - node.min[axis])
+                axis = a;
+        }
+
+        const AlignedArray<float>& lane = *lanes[axis];
+        int middle = (begin + end) / 2;
+        std::nth_element(m_Indices.begin() + begin, m_Indices.begin() + middle, m_Indices.begin() + end, [&lane](int a, int b) {
+            return lane[a] < lane[b];
+        });
+
+        // children are allocated as a pair so the right one is always left + 1
+        node.left = (int)m_Nodes.size();
+        m_Nodes.resize(m_Nodes.size() + 2);
+        BuildNode(node.left, begin, middle);
+        BuildNode(node.left + 1, middle, end);
+    }
+
+    m_Nodes[index] = node;
+}
+
+float KdTree::BoxDistanceSq(const Node& node, const float point[3]) const
+{
+    float distanceSq = 0.0f;
+    for(int axis = 0; axis < 3; axis++) {
+        float below = node.min[axis] - point[axis];
+        float above = point[axis] - node.max[axis];
+        float distance = std::max(std::max(below, above), 0.0f);
+
+        // on a periodic bound the box may be closer around the far face
+        if(m_Periodic && distance > 0.0f)
+            distance = std::min(distance, std::max(BOUND_SIZE - std::max(node.max[axis] - point[axis], point[axis] - node.min[axis]), 0.0f));
+
+        distanceSq += distance * distance;
+    }
+    return distanceSq;
+}
+
+#pragma endregion
+
+#pragma region flock
+
+float FlockParams::GetNeighborDistance(void) const
+{
+    return std::max(separateDistance, std::max(alignDistance, cohereDistance));
+}
+
+SpeciesMatrix::SpeciesMatrix(void)
+{
+    std::fill(&separate[0][0], &separate[0][0] + SPECIES_MAX * SPECIES_MAX, 1.0f);
+    std::fill(&align[0][0], &align[0][0] + SPECIES_MAX * SPECIES_MAX, 1.0f);
+    std::fill(&cohere[0][0], &cohere[0][0] + SPECIES_MAX * SPECIES_MAX, 1.0f);
+}
+
+Flock::Flock(void)
+{
+    m_ThreadPool.Init(ThreadPool::GetHardwareThreadCount());
+    m_Workspaces.resize(m_ThreadPool.GetThreadCount());
+    m_Options.threadCount = m_ThreadPool.GetThreadCount();
+
+    // pick the widest neighbor kernel the cpu supports and that agrees with the scalar one
+    m_MaxSimdLevel = GetSupportedSimdLevel();
+    m_Options.simdLevel = m_MaxSimdLevel;
+
+    // stats report -1 misses when the counter can't be opened
+    m_CacheMissCounter.Open();
+}
+
+Flock::~Flock() {}
+
+void Flock::Init(int count)
+{
+    m_Store.Resize(0);
+    Spawn(count);
+
+    m_Alpha = AlphaState();
+    m_StepsUntilSort = 0;
+    m_StepsUntilRecluster = 0;
+    m_SteeringPhase = 0;
+}
+
+void Flock::Step(void)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    m_CacheMissCounter.Start();
+
+    // sort before the grid is built so its cell lists index the sorted store
+    if((m_Options.sortInterval > 0 && --m_StepsUntilSort <= 0) || !m_SpeciesSorted) {
+        SortBoids();
+        m_StepsUntilSort = m_Options.sortInterval;
+    }
+    m_MixedSpecies = !IsInteractionUniform();
+
+    int count = m_Store.GetCount();
+    for(FlockWorkspace& workspace : m_Workspaces) {
+        workspace.neighborCandidates = 0;
+        workspace.neighborLines = 0;
+        workspace.separationTests = 0;
+        workspace.separationPairs = 0;
+    }
+
+    m_Store.SavePreviousPositions();
+    m_Alpha.previousPosition = m_Alpha.position;
+
+    // members stay in the search structures at their real positions, so collapse before they're built
+    if(m_Options.lod)
+        UpdateLod();
+    else if(!m_SuperBoids.empty())
+        ExpandAll();
+
+    // in place updates move neighbors during the step, so pad the search by the distance they can travel
+    float radius = GetMaxNeighborDistance() + (m_Options.doubleBuffered ? 0.0f : GetMaxSpeed());
+    std::chrono::steady_clock::time_point indexStart = std::chrono::steady_clock::now();
+    if(m_Options.topological) {
+        m_KdTree.Build(m_Store, m_Options.periodic);
+    } else if(m_Options.neighborLists) {
+        UpdateNeighborLists(radius);
+    } else {
+        PrepareSearch(radius, UseCellAggregates() ? GRID_AGGREGATE_SUBDIVISION : 1);
+        m_ListsValid = false;
+        m_ListStats = NeighborListStats();
+    }
+    double indexMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - indexStart).count();
+
+    // separation stays metric in every mode but topological, where it only sees the k nearest
+    // a staggered step only steers one slice, the half shell would separate every boid for nothing
+    // and the fused kernel would skip separation math it gets for almost nothing
+    m_HalfShell = false;
+    if(m_Options.halfShellSeparation && m_Options.doubleBuffered && !m_Options.fusedSteering && !m_Options.topological && m_Options.steeringSlices <= 1)
+        SeparateHalfShell();
+
+    if(m_Options.doubleBuffered) {
+        m_NextStore.Resize(count);
+        m_ThreadPool.ParallelFor(count, m_Options.threadCount, [this](int begin, int end, int thread) {
+            for(int i = begin; i < end; i++)
+                StepBoid(i, m_NextStore, m_Workspaces[thread]);
+        });
+        m_ThreadPool.ParallelFor((int)m_SuperBoids.size(), m_Options.threadCount, [this](int begin, int end, int thread) {
+            for(int i = begin; i < end; i++)
+                StepSuperBoid(i, m_NextStore, m_Workspaces[thread]);
+        });
+        m_Store.SwapKinematics(m_NextStore);
+    } else {
+        for(int i = 0; i < count; i++)
+            StepBoid(i, m_Store, m_Workspaces[0]);
+        for(int i = 0; i < (int)m_SuperBoids.size(); i++)
+            StepSuperBoid(i, m_Store, m_Workspaces[0]);
+    }
+
+    UpdateAlpha();
+    m_SteeringPhase++;
+
+    m_Stats = FlockStats();
+    m_Stats.indexMs = indexMs;
+    for(const FlockWorkspace& workspace : m_Workspaces) {
+        m_Stats.neighborCandidates += workspace.neighborCandidates;
+        m_Stats.neighborLines += workspace.neighborLines;
+        m_Stats.separationTests += workspace.separationTests;
+        m_Stats.separationPairs += workspace.separationPairs;
+    }
+    m_Stats.cacheMisses = m_CacheMissCounter.Stop();
+
+    if(m_Options.neighborLists && !m_ListStats.overflowed) {
+        double stepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if(m_ListStats.rebuilt) {
+            m_ListStats.rebuildStepMs = stepMs;
+        } else {
+            m_ListStats.reuseStepMs = stepMs;
+            m_ListStats.savedMs += m_ListStats.rebuildStepMs - stepMs;
+        }
+    }
+}
+
+void Flock::SetCount(int count)
+{
+    count = Clamp(count, 0, BOID_COUNT_MAX);
+    if(count > m_Store.GetCount())
+        Spawn(count - m_Store.GetCount());
+    else if(count < m_Store.GetCount())
+        Despawn(m_Store.GetCount() - count);
+}
+
+void Flock::Spawn(int count)
+{
+    ExpandAll();
+    count = std::min(count, BOID_COUNT_MAX - m_Store.GetCount());
+    for(int i = 0; i < count; i++) {
+        int index = m_Store.Add();
+        m_Store.species[index] = index % m_SpeciesCount;
+        ResetBoid(index);
+    }
+    m_Grid.Invalidate();
+    m_Octree.Invalidate();
+    m_ListsValid = false;
+    m_SpeciesSorted = m_SpeciesCount == 1;
+}
+
+void Flock::Despawn(int count)
+{
+    // remove random boids so the survivors stay spread over the bound
+    ExpandAll();
+    count = std::min(count, m_Store.GetCount());
+    for(int i = 0; i < count; i++)
+        m_Store.Remove(rand() % m_Store.GetCount());
+    m_Grid.Invalidate();
+    m_Octree.Invalidate();
+    m_ListsValid = false;
+    m_SpeciesSorted = m_SpeciesCount == 1;
+}
+
+FlockStore& Flock::GetStore(void) { return m_Store; }
+const FlockStore& Flock::GetStore(void) const { return m_Store; }
+FlockParams& Flock::GetParams(int species) { return m_Params[species]; }
+FlockOptions& Flock::GetOptions(void) { return m_Options; }
+SpeciesMatrix& Flock::GetInteraction(void) { return m_Interaction; }
+AlphaState& Flock::GetAlpha(void) { return m_Alpha; }
+const AlphaState& Flock::GetAlpha(void) const { return m_Alpha; }
+const SpatialGrid& Flock::GetGrid(void) const { return m_Grid; }
+const SpatialOctree& Flock::GetOctree(void) const { return m_Octree; }
+const KdTree& Flock::GetKdTree(void) const { return m_KdTree; }
+const FlockStats& Flock::GetStats(void) const { return m_Stats; }
+const NeighborListStats& Flock::GetListStats(void) const { return m_ListStats; }
+int Flock::GetSortCount(void) const { return m_SortCount; }
+const std::vector<int>& Flock::GetSortRemap(void) const { return m_SortRemap; }
+int Flock::GetMaxThreadCount(void) const { return m_ThreadPool.GetThreadCount(); }
+SimdLevel Flock::GetMaxSimdLevel(void) const { return m_MaxSimdLevel; }
+const char *Flock::GetKernelName(void) const { return GetSimdLevelName(m_Options.simdLevel); }
+const LodStats& Flock::GetLodStats(void) const { return m_LodStats; }
+
+void Flock::SetViewer(const Point& viewer)
+{
+    m_Viewer = viewer;
+}
+
+void Flock::SetSpeciesCount(int count)
+{
+    count = Clamp(count, 1, SPECIES_MAX);
+    for(int s = m_SpeciesCount; s < count; s++)
+        m_Params[s] = m_Params[0];
+    m_SpeciesCount = count;
+
+    ExpandAll();
+    for(int i = 0; i < m_Store.GetCount(); i++)
+        m_Store.species[i] = i % count;
+    m_ListsValid = false;
+    m_SpeciesSorted = count == 1;
+}
+
+int Flock::GetSpeciesCount(void) const
+{
+    return m_SpeciesCount;
+}
+
+bool Flock::GetSpeciesRange(int species, int& start, int& count) const
+{
+    if(m_SpeciesCount == 1) {
+        start = 0;
+        count = species == 0 ? m_Store.GetCount() : 0;
+        return true;
+    }
+    if(!m_SpeciesSorted)
+        return false;
+
+    start = m_SpeciesStart[species];
+    count = m_SpeciesStart[species + 1] - start;
+    return true;
+}
+
+Point Flock::Interpolate(const Point& previous, const Point& current, float t)
+{
+    // a boid mirrored to the far side this tick snaps instead of sweeping across the bound
+    float radius = BOUND_SIZE * 0.5f;
+    if(fabs(current.x - previous.x) > radius || fabs(current.y - previous.y) > radius || fabs(current.z - previous.z) > radius)
+        return current;
+
+    return Point(
+        previous.x + (current.x - previous.x) * t,
+        previous.y + (current.y - previous.y) * t,
+        previous.z + (current.z - previous.z) * t);
+}
+
+void Flock::StepBoid(int index, FlockStore& target, FlockWorkspace& workspace)
+{
+    // members are moved by their super boid
+    if(!m_SuperBoids.empty() && m_BoidSuper[index] >= 0)
+        return;
+
+    // boids outside this step's slice integrate the steering from the last step they were in
+    int slices = std::max(m_Options.steeringSlices, 1);
+    if(slices > 1 && index % slices != m_SteeringPhase % slices) {
+        m_Store.ax[index] = m_Store.sx[index];
+        m_Store.ay[index] = m_Store.sy[index];
+        m_Store.az[index] = m_Store.sz[index];
+        Integrate(index, target);
+        Mirror(target.px[index], target.py[index], target.pz[index]);
+        return;
+    }
+
+    const std::vector<int>& neighbors = QueryNeighbors(index, workspace.neighbors, workspace.far);
+    // every search hands back the boid itself
+    workspace.neighborCandidates += neighbors.size() - 1;
+
+    // neighbors on the cache line of the one before them come for free
+    int line = -1;
+    for(int n = 0; n < (int)neighbors.size(); n++) {
+        if(neighbors[n] / FLOCK_LINE_FLOATS != line) {
+            line = neighbors[n] / FLOCK_LINE_FLOATS;
+            workspace.neighborLines++;
+        }
+    }
+
+    if(m_Options.fusedSteering) {
+        SteerFused(index, neighbors, workspace.far);
+    } else {
+        if(!m_HalfShell)
+            Separate(index, neighbors);
+        Align(index, neighbors, workspace.far);
+        Cohere(index, neighbors, workspace.far);
+    }
+
+    if(slices > 1) {
+        m_Store.sx[index] = m_Store.ax[index];
+        m_Store.sy[index] = m_Store.ay[index];
+        m_Store.sz[index] = m_Store.az[index];
+    }
+
+    Integrate(index, target);
+    Mirror(target.px[index], target.py[index], target.pz[index]);
+}
+
+const std::vector<int>& Flock::QueryNeighbors(int index, std::vector<int>& buffer, NeighborSums& far)
+{
+    far = NeighborSums();
+
+    // the boid itself is always nearest, so ask for one more
+    if(m_Options.topological) {
+        m_KdTree.QueryNearest(m_Store.px[index], m_Store.py[index], m_Store.pz[index], m_Options.topologicalCount + 1, buffer);
+        return buffer;
+    }
+
+    if(m_Options.neighborLists && !m_ListStats.overflowed) {
+        const int *list = m_Workspaces[m_ListThread[index]].listNeighbors.data() + m_ListStart[index];
+        buffer.assign(list, list + m_ListCount[index]);
+        return buffer;
+    }
+
+    if(UseCellAggregates()) {
+        const FlockParams& params = GetBoidParams(index);
+        float farDistance = std::min(params.alignDistance, params.cohereDistance);
+        m_Grid.QueryAggregated(m_Store.px[index], m_Store.py[index], m_Store.pz[index],
+            m_SearchRadius, params.separateDistance, farDistance, buffer, far);
+        return buffer;
+    }
+
+    return SearchNeighbors(m_Store.px[index], m_Store.py[index], m_Store.pz[index], buffer);
+}
+
+const std::vector<int>& Flock::SearchNeighbors(float x, float y, float z, std::vector<int>& buffer)
+{
+    if(m_Options.neighborSearch == NeighborSearch::Grid) {
+        m_Grid.Query(x, y, z, buffer);
+        return buffer;
+    }
+    if(m_Options.neighborSearch == NeighborSearch::Octree) {
+        m_Octree.Query(x, y, z, buffer);
+        return buffer;
+    }
+
+    return m_AllBoids;
+}
+
+void Flock::PrepareSearch(float radius, int subdivision)
+{
+    int count = m_Store.GetCount();
+    m_SearchRadius = radius;
+    if(m_Options.neighborSearch == NeighborSearch::Grid) {
+        // finer cells are for queries that cull cells by distance, the plain query needs cells as wide as the radius
+        float cellSize = radius / subdivision;
+        int threadCount = m_Options.doubleBuffered ? m_Options.threadCount : 1;
+        if(m_Options.incrementalGrid)
+            m_Grid.Update(m_Store, cellSize, m_Options.periodic, m_ThreadPool, threadCount);
+        else
+            m_Grid.Build(m_Store, cellSize, m_Options.periodic, m_ThreadPool, threadCount);
+
+        if(UseCellAggregates())
+            m_Grid.BuildAggregates(m_Store);
+    } else if(m_Options.neighborSearch == NeighborSearch::Octree) {
+        m_Octree.Update(m_Store, radius, m_Options.periodic);
+    } else if((int)m_AllBoids.size() != count) {
+        // brute force visits every boid
+        m_AllBoids.resize(count);
+        for(int i = 0; i < count; i++)
+            m_AllBoids[i] = i;
+    }
+}
+
+bool Flock::UseCellAggregates(void) const
+{
+    // lists and the kd tree hand out plain neighbor indices, so sums only replace the grid query
+    // cell sums don't know the species either, so they only stand in while every interaction factor is 1
+    return m_Options.cellAggregates && m_Options.neighborSearch == NeighborSearch::Grid && !m_Options.neighborLists && !m_Options.topological && !m_MixedSpecies;
+}
+
+const FlockParams& Flock::GetBoidParams(int index) const
+{
+    return m_Params[m_Store.species[index]];
+}
+
+float Flock::GetMaxNeighborDistance(void) const
+{
+    float distance = 0.0f;
+    for(int s = 0; s < m_SpeciesCount; s++)
+        distance = std::max(distance, m_Params[s].GetNeighborDistance());
+    return distance;
+}
+
+float Flock::GetMaxSpeed(void) const
+{
+    float speed = 0.0f;
+    for(int s = 0; s < m_SpeciesCount; s++)
+        speed = std::max(speed, m_Params[s].maxSpeed);
+    return speed;
+}
+
+bool Flock::IsInteractionUniform(void) const
+{
+    for(int row = 0; row < m_SpeciesCount; row++) {
+        for(int column = 0; column < m_SpeciesCount; column++) {
+            if(m_Interaction.separate[row][column] != 1.0f || m_Interaction.align[row][column] != 1.0f || m_Interaction.cohere[row][column] != 1.0f)
+                return false;
+        }
+    }
+    return true;
+}
+
+void Flock::PrepareQuery(NeighborQuery& query, int species, const FlockParams& params) const
+{
+    // everything but the steering boid itself
+    query.px = m_Store.px.GetData();
+    query.py = m_Store.py.GetData();
+    query.pz = m_Store.pz.GetData();
+    query.fx = m_Store.fx.GetData();
+    query.fy = m_Store.fy.GetData();
+    query.fz = m_Store.fz.GetData();
+    query.period = m_Options.periodic ? BOUND_SIZE : 0.0f;
+    query.inversePeriod = m_Options.periodic ? 1.0f / BOUND_SIZE : 0.0f;
+    query.separateDistance = params.separateDistance;
+    query.separateDistanceSq = params.separateDistance * params.separateDistance;
+    query.alignDistanceSq = m_Options.topological ? FLT_MAX : params.alignDistance * params.alignDistance;
+    query.cohereDistanceSq = m_Options.topological ? FLT_MAX : params.cohereDistance * params.cohereDistance;
+    query.maxSpeed = params.maxSpeed;
+    query.maxForce = params.maxForce;
+    query.separateWeight = params.separateWeight;
+
+    if(m_MixedSpecies) {
+        query.species = m_Store.species.GetData();
+        query.separateFactors = m_Interaction.separate[species];
+        query.alignFactors = m_Interaction.align[species];
+        query.cohereFactors = m_Interaction.cohere[species];
+    }
+}
+
+float Flock::GetListSkin(void) const
+{
+    if(m_Options.listSkin > 0.0f)
+        return m_Options.listSkin;
+
+    // two boids closing head on at the top speed use up the skin in this many steps
+    return 2.0f * GetMaxSpeed() * std::max(m_Options.listReuseSteps, 1);
+}
+
+void Flock::UpdateNeighborLists(float radius)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    float skin = GetListSkin();
+    float listRadius = radius + skin;
+
+    bool rebuild = !m_ListsValid || listRadius != m_ListRadius || m_Options.periodic != m_ListPeriodic;
+    if(!rebuild && m_ListStats.overflowed) {
+        // too many pairs to cache at this setup, search directly until something changes
+        PrepareSearch(radius, 1);
+        return;
+    }
+    m_ListDrift = Vector();
+    if(!rebuild) {
+        m_ListDrift = GetListDrift();
+        rebuild = ListsMoved(m_ListDrift, skin * 0.5f);
+    }
+
+    m_ListStats.steps++;
+    m_ListStats.rebuilt = rebuild;
+    m_ListStats.checkMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if(rebuild) {
+        start = std::chrono::steady_clock::now();
+        PrepareSearch(listRadius, GRID_LIST_SUBDIVISION);
+        BuildNeighborLists(listRadius);
+        m_ListDrift = Vector();
+        m_ListStats.rebuilds++;
+        m_ListStats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void Flock::BuildNeighborLists(float radius)
+{
+    int count = m_Store.GetCount();
+    m_ListStart.resize(count);
+    m_ListCount.resize(count);
+    m_ListThread.resize(count);
+    for(FlockWorkspace& workspace : m_Workspaces) {
+        workspace.listNeighbors.clear();
+        workspace.listOverflowed = false;
+    }
+
+    // each thread appends to its own list, so the build needs no merge
+    int threadCount = m_Options.doubleBuffered ? m_Options.threadCount : 1;
+    m_ThreadPool.ParallelFor(count, threadCount, [this, radius](int begin, int end, int thread) {
+        for(int i = begin; i < end; i++)
+            BuildNeighborList(i, radius, m_Workspaces[thread]);
+    });
+
+    m_ListStats.overflowed = false;
+    for(const FlockWorkspace& workspace : m_Workspaces)
+        m_ListStats.overflowed |= workspace.listOverflowed;
+
+    m_ListX.assign(m_Store.px.GetData(), m_Store.px.GetData() + count);
+    m_ListY.assign(m_Store.py.GetData(), m_Store.py.GetData() + count);
+    m_ListZ.assign(m_Store.pz.GetData(), m_Store.pz.GetData() + count);
+    m_ListRadius = radius;
+    m_ListPeriodic = m_Options.periodic;
+    m_ListsValid = true;
+}
+
+void Flock::BuildNeighborList(int index, float radius, FlockWorkspace& workspace)
+{
+    std::vector<int>& list = workspace.listNeighbors;
+    if(workspace.listOverflowed || list.size() > NEIGHBOR_LIST_MAX_ENTRIES / m_Workspaces.size()) {
+        workspace.listOverflowed = true;
+        return;
+    }
+
+    m_ListStart[index] = (int)list.size();
+    m_ListThread[index] = (int)(&workspace - m_Workspaces.data());
+
+    // keep the candidates inside the radius, self included like every search backend
+    // positions stay inside the bound, so one period is the most an offset can be off by
+    float half = m_Options.periodic ? BOUND_SIZE * 0.5f : FLT_MAX;
+    float x = m_Store.px[index], y = m_Store.py[index], z = m_Store.pz[index];
+    float radiusSq = radius * radius;
+
+    // the list radius spans most of the bound in a 27 cell block, so the grid is built finer and culled by distance
+    bool grid = m_Options.neighborSearch == NeighborSearch::Grid;
+    if(grid)
+        m_Grid.QueryRadius(x, y, z, radius, workspace.neighbors);
+    const std::vector<int>& found = grid ? workspace.neighbors : SearchNeighbors(x, y, z, workspace.neighbors);
+
+    // every candidate is written and only the ones inside advance the end, about half are kept so a branch would mispredict
+    list.resize(m_ListStart[index] + found.size());
+    int *end = list.data() + m_ListStart[index];
+    for(int n = 0; n < (int)found.size(); n++) {
+        int i = found[n];
+        float dx = x - m_Store.px[i];
+        float dy = y - m_Store.py[i];
+        float dz = z - m_Store.pz[i];
+        dx = dx > half ? dx - BOUND_SIZE : (dx < -half ? dx + BOUND_SIZE : dx);
+        dy = dy > half ? dy - BOUND_SIZE : (dy < -half ? dy + BOUND_SIZE : dy);
+        dz = dz > half ? dz - BOUND_SIZE : (dz < -half ? dz + BOUND_SIZE : dz);
+        *end = i;
+        end += dx * dx + dy * dy + dz * dz <= radiusSq;
+    }
+    list.resize(end - list.data());
+
+    m_ListCount[index] = (int)list.size() - m_ListStart[index];
+}
+
+Vector Flock::GetListDrift(void) const
+{
+    int count = m_Store.GetCount();
+    Vector drift;
+    for(int i = 0; i < count; i++)
+        drift = drift + MinimumImage(Vector(m_Store.px[i] - m_ListX[i], m_Store.py[i] - m_ListY[i], m_Store.pz[i] - m_ListZ[i]));
+    return count > 0 ? (1.0f / count) * drift : drift;
+}
+
+bool Flock::ListsMoved(const Vector& drift, float distance) const
+{
+    // only the motion of boids relative to each other changes which pairs are close
+    // so the displacements are measured against the flock's mean drift, which a flying flock shares
+    int count = m_Store.GetCount();
+    float distanceSq = distance * distance;
+    for(int i = 0; i < count; i++) {
+        Vector offset = MinimumImage(Vector(m_Store.px[i] - m_ListX[i], m_Store.py[i] - m_ListY[i], m_Store.pz[i] - m_ListZ[i])) - drift;
+        if(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z > distanceSq)
+            return true;
+    }
+    return false;
+}
+
+void Flock::SeparateHalfShell(void)
+{
+    int threadCount = std::min(m_Options.threadCount, (int)m_Workspaces.size());
+    float separateDistance = 0.0f;
+    for(int s = 0; s < m_SpeciesCount; s++)
+        separateDistance = std::max(separateDistance, m_Params[s].separateDistance);
+    m_SeparationGrid.Build(m_Store, separateDistance, m_Options.periodic, m_ThreadPool, threadCount);
+    if(!m_SeparationGrid.SupportsHalfShell())
+        return;
+    m_HalfShell = true;
+
+    // windows of one color share no cell, so their pairs add straight into the acceleration
+    m_SeparationGrid.BuildBlocks();
+    for(int color = 0; color < m_SeparationGrid.GetBlockColorCount(); color++) {
+        int first, last;
+        m_SeparationGrid.GetBlockRange(color, first, last);
+        if(first == last)
+            continue;
+
+        m_ThreadPool.ParallelFor(last - first, threadCount, [this, first](int begin, int end, int thread) {
+            for(int b = first + begin; b < first + end; b++)
+                SeparateBlock(b, m_Workspaces[thread]);
+        });
+    }
+}
+
+void Flock::SeparateBlock(int block, FlockWorkspace& workspace)
+{
+    int pairs[GRID_BLOCK_PAIRS][2];
+    int pairCount = m_SeparationGrid.GetBlockPairs(block, pairs);
+    for(int p = 0; p < pairCount; p++) {
+        int firstCount, secondCount;
+        const int *first = m_SeparationGrid.GetCellBoids(pairs[p][0], firstCount);
+        const int *second = m_SeparationGrid.GetCellBoids(pairs[p][1], secondCount);
+        bool same = pairs[p][0] == pairs[p][1];
+        for(int a = 0; a < firstCount; a++) {
+            for(int b = same ? a + 1 : 0; b < secondCount; b++)
+                SeparatePair(first[a], second[b], workspace);
+        }
+    }
+}
+
+void Flock::SeparatePair(int first, int second, FlockWorkspace& workspace)
+{
+    workspace.separationTests++;
+
+    float half = m_Options.periodic ? BOUND_SIZE * 0.5f : FLT_MAX;
+    float dx = m_Store.px[first] - m_Store.px[second];
+    float dy = m_Store.py[first] - m_Store.py[second];
+    float dz = m_Store.pz[first] - m_Store.pz[second];
+    dx = dx > half ? dx - BOUND_SIZE : (dx < -half ? dx + BOUND_SIZE : dx);
+    dy = dy > half ? dy - BOUND_SIZE : (dy < -half ? dy + BOUND_SIZE : dy);
+    dz = dz > half ? dz - BOUND_SIZE : (dz < -half ? dz + BOUND_SIZE : dz);
+
+    // species with different separation distances may only push one of the two
+    float distanceSq = dx * dx + dy * dy + dz * dz;
+    const FlockParams& firstParams = GetBoidParams(first);
+    const FlockParams& secondParams = GetBoidParams(second);
+    bool separateFirst = distanceSq <= firstParams.separateDistance * firstParams.separateDistance;
+    bool separateSecond = distanceSq <= secondParams.separateDistance * secondParams.separateDistance;
+    if(!separateFirst && !separateSecond)
+        return;
+    workspace.separationPairs++;
+
+    // the push is opposite, except on top of each other where Vector::Normalize sends both along +x
+    Vector direction = Vector::Normalize(Vector(dx, dy, dz));
+    float distance = sqrtf(distanceSq);
+    if(separateFirst)
+        AccumulateSeparation(first, second, Clamp(firstParams.separateDistance / distance, 0.0f, firstParams.maxSpeed) * direction);
+    if(separateSecond) {
+        Vector desired = Clamp(secondParams.separateDistance / distance, 0.0f, secondParams.maxSpeed) * direction;
+        AccumulateSeparation(second, first, Equal(distance, 0.0f) ? desired : Vector(-desired.x, -desired.y, -desired.z));
+    }
+}
+
+void Flock::AccumulateSeparation(int index, int neighbor, const Vector& desired)
+{
+    // each boid still clamps the force against its own velocity, the acceleration is zero at the start of the step
+    const FlockParams& params = GetBoidParams(index);
+    Vector force = SteerForce(params, desired, m_Store.GetVelocity(index), params.separateWeight);
+    float factor = m_Interaction.separate[m_Store.species[index]][m_Store.species[neighbor]] / params.mass;
+
+    m_Store.ax[index] += factor * force.x;
+    m_Store.ay[index] += factor * force.y;
+    m_Store.az[index] += factor * force.z;
+}
+
+void Flock::Separate(int index, const std::vector<int>& neighbors)
+{
+    float x = m_Store.px[index], y = m_Store.py[index], z = m_Store.pz[index];
+    const FlockParams& params = GetBoidParams(index);
+    const float *factors = m_Interaction.separate[m_Store.species[index]];
+    float inverseMass = 1.0f / params.mass;
+
+    for(int n = 0; n < (int)neighbors.size(); n++) {
+        int i = neighbors[n];
+        if(i == index)
+            continue;
+
+        Vector offset = MinimumImage(Vector(x - m_Store.px[i], y - m_Store.py[i], z - m_Store.pz[i]));
+        float distance = offset.Magnitude();
+
+        if(distance <= params.separateDistance) {
+            Vector desired = Vector::Normalize(offset);
+            desired = Clamp(params.separateDistance / distance, 0.0f, params.maxSpeed) * desired;
+            Vector force = factors[m_Store.species[i]] * SteerForce(params, desired, m_Store.GetVelocity(index), params.separateWeight);
+            m_Store.ax[index] += inverseMass * force.x;
+            m_Store.ay[index] += inverseMass * force.y;
+            m_Store.az[index] += inverseMass * force.z;
+        }
+    }
+}
+
+void Flock::Align(int index, const std::vector<int>& neighbors, const NeighborSums& far)
+{
+    float x = m_Store.px[index], y = m_Store.py[index], z = m_Store.pz[index];
+    const FlockParams& params = GetBoidParams(index);
+    const float *factors = m_Interaction.align[m_Store.species[index]];
+
+    Vector averageForward(far.forwardX, far.forwardY, far.forwardZ);
+
+    for(int n = 0; n < (int)neighbors.size(); n++) {
+        int i = neighbors[n];
+        if(i == index)
+            continue;
+
+        float distance = MinimumImage(Vector(x - m_Store.px[i], y - m_Store.py[i], z - m_Store.pz[i])).Magnitude();
+
+        if(distance <= params.alignDistance || m_Options.topological)
+            averageForward = averageForward + factors[m_Store.species[i]] * m_Store.GetForward(i);
+    }
+
+    averageForward.Normalize();
+    averageForward = params.maxSpeed * averageForward;
+    Steer(index, averageForward, params.alignWeight);
+
+    // align alpha
+    Steer(index, m_Alpha.forward * params.maxSpeed, params.alphaAlignWeight);
+}
+
+void Flock::Cohere(int index, const std::vector<int>& neighbors, const NeighborSums& far)
+{
+    float x = m_Store.px[index], y = m_Store.py[index], z = m_Store.pz[index];
+    const FlockParams& params = GetBoidParams(index);
+    const float *factors = m_Interaction.cohere[m_Store.species[index]];
+
+    Vector averagePosition(far.centerX, far.centerY, far.centerZ);
+    float weight = far.cohereWeight;
+
+    for(int n = 0; n < (int)neighbors.size(); n++) {
+        int i = neighbors[n];
+        if(i == index)
+            continue;
+
+        Vector offset(x - m_Store.px[i], y - m_Store.py[i], z - m_Store.pz[i]);
+        Vector imageOffset = MinimumImage(offset);
+        float distance = imageOffset.Magnitude();
+
+        if(distance <= params.cohereDistance || m_Options.topological) {
+            // sum the image of the neighbor on this boid's side of the bound, weighted by the factor
+            float factor = factors[m_Store.species[i]];
+            averagePosition = averagePosition + factor * (m_Store.GetPosition(i) + (offset - imageOffset));
+            weight += factor;
+        }
+    }
+
+    if(weight > 0.0f)
+        averagePosition = (1.0f / weight) * averagePosition;
+
+    Seek(index, Point(averagePosition.x, averagePosition.y, averagePosition.z), params.maxSpeed, params.cohereWeight);
+
+    // cohere alpha
+    Seek(index, m_Alpha.position, params.maxSpeed, params.alphaCohereWeight);
+}
+
+void Flock::SteerFused(int index, const std::vector<int>& neighbors, const NeighborSums& far)
+{
+    // single pass equivalent of Separate, Align and Cohere, forces are applied in the same order
+    const FlockParams& params = GetBoidParams(index);
+    NeighborQuery query;
+    PrepareQuery(query, m_Store.species[index], params);
+    query.self = index;
+    query.x = m_Store.px[index];
+    query.y = m_Store.py[index];
+    query.z = m_Store.pz[index];
+    query.vx = m_Store.vx[index];
+    query.vy = m_Store.vy[index];
+    query.vz = m_Store.vz[index];
+
+    // aggregated cells are already summed, the kernel adds the scanned neighbors on top
+    NeighborSums sums = far;
+    GetNeighborKernel(m_Options.simdLevel)(query, neighbors.data(), (int)neighbors.size(), sums);
+
+    // separate
+    float inverseMass = 1.0f / params.mass;
+    m_Store.ax[index] += inverseMass * sums.separateX;
+    m_Store.ay[index] += inverseMass * sums.separateY;
+    m_Store.az[index] += inverseMass * sums.separateZ;
+
+    // align
+    Vector averageForward = params.maxSpeed * Vector::Normalize(Vector(sums.forwardX, sums.forwardY, sums.forwardZ));
+    Steer(index, averageForward, params.alignWeight);
+    Steer(index, m_Alpha.forward * params.maxSpeed, params.alphaAlignWeight);
+
+    // cohere
+    Point averagePosition(sums.centerX, sums.centerY, sums.centerZ);
+    if(sums.cohereWeight > 0.0f)
+        averagePosition = Point(sums.centerX / sums.cohereWeight, sums.centerY / sums.cohereWeight, sums.centerZ / sums.cohereWeight);
+    Seek(index, averagePosition, params.maxSpeed, params.cohereWeight);
+    Seek(index, m_Alpha.position, params.maxSpeed, params.alphaCohereWeight);
+}
+
+Vector Flock::MinimumImage(const Vector& offset) const
+{
+    if(!m_Options.periodic)
+        return offset;
+
+    return Vector(
+        offset.x - BOUND_SIZE * rintf(offset.x / BOUND_SIZE),
+        offset.y - BOUND_SIZE * rintf(offset.y / BOUND_SIZE),
+        offset.z - BOUND_SIZE * rintf(offset.z / BOUND_SIZE));
+}
+
+void Flock::Steer(int index, const Vector& desired, float weight)
+{
+    const FlockParams& params = GetBoidParams(index);
+    Vector force = SteerForce(params, desired, m_Store.GetVelocity(index), weight);
+
+    float inverseMass = 1.0f / params.mass;
+    m_Store.ax[index] += inverseMass * force.x;
+    m_Store.ay[index] += inverseMass * force.y;
+    m_Store.az[index] += inverseMass * force.z;
+}
+
+void Flock::Seek(int index, const Point& target, float speed, float weight)
+{
+    const FlockParams& params = GetBoidParams(index);
+    Vector force = SeekForce(params, m_Store.GetPosition(index), m_Store.GetVelocity(index), target, speed, weight);
+
+    float inverseMass = 1.0f / params.mass;
+    m_Store.ax[index] += inverseMass * force.x;
+    m_Store.ay[index] += inverseMass * force.y;
+    m_Store.az[index] += inverseMass * force.z;
+}
+
+Vector Flock::SteerForce(const FlockParams& params, const Vector& desired, const Vector& velocity, float weight) const
+{
+    Vector force = desired - velocity;
+    if(force.Magnitude() > params.maxForce) {
+        force.Normalize();
+        force = params.maxForce * force * weight;
+    }
+    return force;
+}
+
+Vector Flock::SeekForce(const FlockParams& params, const Point& position, const Vector& velocity, const Point& target, float speed, float weight) const
+{
+    // the alpha may be closer through the far face
+    Vector offset = MinimumImage(target - position);
+    Vector direction = Vector::Normalize(offset);
+    float distance = offset.Magnitude();
+
+    Vector desired = speed * direction;
+    if(distance < params.arrivalDistance)
+        desired = (distance / params.arrivalDistance) * desired;
+
+    return SteerForce(params, desired, velocity, weight);
+}
+
+void Flock::Integrate(int index, FlockStore& target)
+{
+    // update velocity
+    float maxSpeed = GetBoidParams(index).maxSpeed;
+    Vector velocity(m_Store.vx[index] + m_Store.ax[index], m_Store.vy[index] + m_Store.ay[index], m_Store.vz[index] + m_Store.az[index]);
+    if(velocity.Magnitude() > maxSpeed) {
+        velocity.Normalize();
+        velocity = maxSpeed * velocity;
+    }
+    target.SetVelocity(index, velocity);
+
+    // update forward
+    Vector forward = Vector::Normalize(velocity);
+    target.fx[index] = forward.x;
+    target.fy[index] = forward.y;
+    target.fz[index] = forward.z;
+
+    // translate
+    target.px[index] = m_Store.px[index] + velocity.x;
+    target.py[index] = m_Store.py[index] + velocity.y;
+    target.pz[index] = m_Store.pz[index] + velocity.z;
+
+    // reset acceleration
+    m_Store.ax[index] = 0.0f;
+    m_Store.ay[index] = 0.0f;
+    m_Store.az[index] = 0.0f;
+}
+
+void Flock::UpdateAlpha(void)
+{
+    m_Alpha.forward = AffineTransform::RotateY(m_Alpha.yaw) * AffineTransform::RotateX(m_Alpha.pitch) * Vector(0.0f, 0.0f, -1.0f);
+    // the alpha leads the first species and flies within its limit
+    m_Alpha.velocity = m_Alpha.speed * m_Alpha.forward;
+    if(m_Alpha.velocity.Magnitude() > m_Params[0].maxSpeed) {
+        m_Alpha.velocity.Normalize();
+        m_Alpha.velocity = m_Params[0].maxSpeed * m_Alpha.velocity;
+    }
+    m_Alpha.forward = Vector::Normalize(m_Alpha.velocity);
+    m_Alpha.position = m_Alpha.position + m_Alpha.velocity;
+
+    Mirror(m_Alpha.position.x, m_Alpha.position.y, m_Alpha.position.z);
+}
+
+void Flock::SortBoids(void)
+{
+    int count = m_Store.GetCount();
+
+    // key on the species then the cell at the current neighbor distance, the index in the low bits keeps the sort stable
+    // cells are at least a unit wide, so the morton key stays well below the species bits
+    float cellSize = GetMaxNeighborDistance();
+    m_SortKeys.resize(count);
+    for(int i = 0; i < count; i++) {
+        uint64_t morton = SpatialGrid::GetMortonKey(m_Store.px[i], m_Store.py[i], m_Store.pz[i], cellSize);
+        m_SortKeys[i] = ((uint64_t)m_Store.species[i] << 59) | (morton << 32) | (uint64_t)i;
+    }
+    std::sort(m_SortKeys.begin(), m_SortKeys.end());
+
+    m_SortOrder.resize(count);
+    m_SortRemap.resize(count);
+    for(int i = 0; i < count; i++) {
+        m_SortOrder[i] = (int)(m_SortKeys[i] & 0xffffffff);
+        m_SortRemap[m_SortOrder[i]] = i;
+    }
+
+    m_Store.Reorder(m_SortOrder, m_NextStore);
+    m_Grid.Remap(m_SortRemap);
+    RemapSuperBoids();
+
+    std::fill(m_SpeciesStart, m_SpeciesStart + SPECIES_MAX + 1, count);
+    for(int i = count - 1; i >= 0; i--)
+        m_SpeciesStart[m_Store.species[i]] = i;
+    for(int s = SPECIES_MAX - 1; s >= 0; s--)
+        m_SpeciesStart[s] = std::min(m_SpeciesStart[s], m_SpeciesStart[s + 1]);
+    m_SpeciesSorted = true;
+    m_Octree.Invalidate();
+    m_ListsValid = false;
+    m_SortCount++;
+}
+
+void Flock::ResetBoid(int index)
+{
+    m_Store.SetPosition(index, Point(
+        Random(-BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f),
+        Random(-BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f),
+        Random(-BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f)));
+    m_Store.ppx[index] = m_Store.px[index];
+    m_Store.ppy[index] = m_Store.py[index];
+    m_Store.ppz[index] = m_Store.pz[index];
+    m_Store.SetVelocity(index, GetBoidParams(index).maxSpeed * RandomUnitSphere());
+    m_Store.fx[index] = 0.0f;
+    m_Store.fy[index] = 0.0f;
+    m_Store.fz[index] = -1.0f;
+    m_Store.ax[index] = 0.0f;
+    m_Store.ay[index] = 0.0f;
+    m_Store.az[index] = 0.0f;
+    m_Store.sx[index] = 0.0f;
+    m_Store.sy[index] = 0.0f;
+    m_Store.sz[index] = 0.0f;
+}
+
+void Flock::Mirror(float& x, float& y, float& z)
+{
+    float radius = BOUND_SIZE * 0.5f;
+
+    if(x > radius)       x = -2.0f * radius + x;
+    else if(x < -radius) x =  2.0f * radius + x;
+    if(y > radius)       y = -2.0f * radius + y;
+    else if(y < -radius) y =  2.0f * radius + y;
+    if(z > radius)       z = -2.0f * radius + z;
+    else if(z < -radius) z =  2.0f * radius + z;
+}
+
+#pragma endregion
+
+#pragma region level_of_detail
+
+// a lone far boid isn't worth a super boid
+#define LOD_MIN_MEMBERS 2
+#define LOD_RESOLUTION_MAX 256
+
+void Flock::UpdateLod(void)
+{
+    // members keep the shape their cluster had when it formed, so clusters are formed anew now and then
+    int reclustered = 0;
+    if(m_Options.lodReclusterInterval > 0 && --m_StepsUntilRecluster <= 0) {
+        reclustered = m_LodStats.members;
+        ExpandAll();
+        m_StepsUntilRecluster = m_Options.lodReclusterInterval;
+    }
+
+    m_BoidSuper.resize(m_Store.GetCount(), -1);
+    m_LodStats.collapsed = 0;
+    m_LodStats.expanded = reclustered;
+
+    ExpandNear();
+    CollapseFar();
+
+    m_LodStats.superBoids = (int)m_SuperBoids.size();
+    m_LodStats.members = 0;
+    for(const SuperBoid& super : m_SuperBoids)
+        m_LodStats.members += (int)super.members.size();
+}
+
+void Flock::CollapseFar(void)
+{
+    // the far distance never drops below the near one, the gap between them keeps clusters from flickering
+    float farDistance = std::max(m_Options.lodFarDistance, m_Options.lodNearDistance);
+    float farDistanceSq = farDistance * farDistance;
+    int resolution = Clamp((int)ceilf(BOUND_SIZE / std::max(m_Options.lodClusterSize, 0.1f)), 1, LOD_RESOLUTION_MAX);
+    float scale = resolution / BOUND_SIZE;
+
+    // key the free far boids on their species and cluster cell, the index in the low bits keeps the sort stable
+    int count = m_Store.GetCount();
+    m_LodKeys.clear();
+    for(int i = 0; i < count; i++) {
+        if(m_BoidSuper[i] >= 0)
+            continue;
+
+        float dx = m_Store.px[i] - m_Viewer.x;
+        float dy = m_Store.py[i] - m_Viewer.y;
+        float dz = m_Store.pz[i] - m_Viewer.z;
+        if(dx * dx + dy * dy + dz * dz <= farDistanceSq)
+            continue;
+
+        int cx = Clamp((int)((m_Store.px[i] + BOUND_SIZE * 0.5f) * scale), 0, resolution - 1);
+        int cy = Clamp((int)((m_Store.py[i] + BOUND_SIZE * 0.5f) * scale), 0, resolution - 1);
+        int cz = Clamp((int)((m_Store.pz[i] + BOUND_SIZE * 0.5f) * scale), 0, resolution - 1);
+        uint64_t cell = (uint64_t)(((m_Store.species[i] * resolution + cz) * resolution + cy) * resolution + cx);
+        m_LodKeys.push_back((cell << 32) | (uint64_t)i);
+    }
+    std::sort(m_LodKeys.begin(), m_LodKeys.end());
+
+    for(int first = 0, last = 0; first < (int)m_LodKeys.size(); first = last) {
+        while(last < (int)m_LodKeys.size() && (m_LodKeys[last] >> 32) == (m_LodKeys[first] >> 32))
+            last++;
+        if(last - first < LOD_MIN_MEMBERS)
+            continue;
+
+        // cells don't straddle the bound, so the plain centroid is the cluster's center
+        SuperBoid super;
+        super.species = m_Store.species[(int)(m_LodKeys[first] & 0xffffffff)];
+        Vector position, velocity;
+        for(int k = first; k < last; k++) {
+            int i = (int)(m_LodKeys[k] & 0xffffffff);
+            super.members.push_back(i);
+            position = position + m_Store.GetPosition(i);
+            velocity = velocity + m_Store.GetVelocity(i);
+            m_BoidSuper[i] = (int)m_SuperBoids.size();
+        }
+
+        float inverseCount = 1.0f / (last - first);
+        super.position = Point(position.x * inverseCount, position.y * inverseCount, position.z * inverseCount);
+        super.velocity = inverseCount * velocity;
+        super.forward = Vector::Normalize(super.velocity);
+        for(int i : super.members)
+            super.offsets.push_back(m_Store.GetPosition(i) - super.position);
+
+        m_LodStats.collapsed += last - first;
+        m_SuperBoids.push_back(std::move(super));
+    }
+}
+
+void Flock::ExpandNear(void)
+{
+    // members already carry their super boid's motion, so expanding only hands them back
+    float nearDistanceSq = m_Options.lodNearDistance * m_Options.lodNearDistance;
+    for(int s = 0; s < (int)m_SuperBoids.size();) {
+        Vector offset = m_SuperBoids[s].position - m_Viewer;
+        if(Vector::Dot(offset, offset) >= nearDistanceSq) {
+            s++;
+            continue;
+        }
+
+        for(int i : m_SuperBoids[s].members)
+            m_BoidSuper[i] = -1;
+        m_LodStats.expanded += (int)m_SuperBoids[s].members.size();
+
+        // fill the hole with the last super boid
+        if(s != (int)m_SuperBoids.size() - 1) {
+            m_SuperBoids[s] = std::move(m_SuperBoids.back());
+            for(int i : m_SuperBoids[s].members)
+                m_BoidSuper[i] = s;
+        }
+        m_SuperBoids.pop_back();
+    }
+}
+
+void Flock::ExpandAll(void)
+{
+    m_SuperBoids.clear();
+    m_BoidSuper.clear();
+    m_LodStats = LodStats();
+}
+
+void Flock::RemapSuperBoids(void)
+{
+    if(m_SuperBoids.empty())
+        return;
+
+    m_BoidSuper.assign(m_Store.GetCount(), -1);
+    for(int s = 0; s < (int)m_SuperBoids.size(); s++) {
+        for(int& i : m_SuperBoids[s].members) {
+            i = m_SortRemap[i];
+            m_BoidSuper[i] = s;
+        }
+    }
+}
+
+void Flock::StepSuperBoid(int index, FlockStore& target, FlockWorkspace& workspace)
+{
+    // one steering evaluation at the centroid stands in for every member
+    SuperBoid& super = m_SuperBoids[index];
+    std::vector<int>& neighbors = workspace.neighbors;
+    QueryNeighborsAt(index, neighbors);
+    // the centroid is no boid and its members are left out, so there's no self to discount
+    workspace.neighborCandidates += neighbors.size();
+
+    const FlockParams& params = m_Params[super.species];
+    NeighborQuery query;
+    PrepareQuery(query, super.species, params);
+    query.self = -1;
+    query.x = super.position.x;
+    query.y = super.position.y;
+    query.z = super.position.z;
+    query.vx = super.velocity.x;
+    query.vy = super.velocity.y;
+    query.vz = super.velocity.z;
+
+    NeighborSums sums;
+    GetNeighborKernel(m_Options.simdLevel)(query, neighbors.data(), (int)neighbors.size(), sums);
+
+    // same forces as SteerFused, summed against the velocity at the start of the step
+    Vector force(sums.separateX, sums.separateY, sums.separateZ);
+    Vector averageForward = params.maxSpeed * Vector::Normalize(Vector(sums.forwardX, sums.forwardY, sums.forwardZ));
+    force = force + SteerForce(params, averageForward, super.velocity, params.alignWeight);
+    force = force + SteerForce(params, m_Alpha.forward * params.maxSpeed, super.velocity, params.alphaAlignWeight);
+
+    Point averagePosition(sums.centerX, sums.centerY, sums.centerZ);
+    if(sums.cohereWeight > 0.0f)
+        averagePosition = Point(sums.centerX / sums.cohereWeight, sums.centerY / sums.cohereWeight, sums.centerZ / sums.cohereWeight);
+    force = force + SeekForce(params, super.position, super.velocity, averagePosition, params.maxSpeed, params.cohereWeight);
+    force = force + SeekForce(params, super.position, super.velocity, m_Alpha.position, params.maxSpeed, params.alphaCohereWeight);
+
+    // integrate
+    Vector velocity = super.velocity + (1.0f / params.mass) * force;
+    if(velocity.Magnitude() > params.maxSpeed) {
+        velocity.Normalize();
+        velocity = params.maxSpeed * velocity;
+    }
+    super.velocity = velocity;
+    super.forward = Vector::Normalize(velocity);
+    super.position = super.position + velocity;
+    Mirror(super.position.x, super.position.y, super.position.z);
+
+    // members ride along at their offsets, any separation the half shell gave them is dropped
+    for(int m = 0; m < (int)super.members.size(); m++) {
+        int i = super.members[m];
+        float x = super.position.x + super.offsets[m].x;
+        float y = super.position.y + super.offsets[m].y;
+        float z = super.position.z + super.offsets[m].z;
+        Mirror(x, y, z);
+
+        target.px[i] = x;
+        target.py[i] = y;
+        target.pz[i] = z;
+        target.SetVelocity(i, velocity);
+        target.fx[i] = super.forward.x;
+        target.fy[i] = super.forward.y;
+        target.fz[i] = super.forward.z;
+        m_Store.ax[i] = 0.0f;
+        m_Store.ay[i] = 0.0f;
+        m_Store.az[i] = 0.0f;
+    }
+}
+
+void Flock::QueryNeighborsAt(int index, std::vector<int>& buffer)
+{
+    const Point& position = m_SuperBoids[index].position;
+
+    // lists only exist per boid, the structure they were built from holds the positions of the last rebuild
+    // so the centroid is moved back by the flock's drift since, the skin covers the relative motion
+    float x = position.x, y = position.y, z = position.z;
+    if(m_Options.neighborLists && !m_ListStats.overflowed) {
+        x -= m_ListDrift.x;
+        y -= m_ListDrift.y;
+        z -= m_ListDrift.z;
+        Mirror(x, y, z);
+    }
+
+    // members sit around the centroid and would crowd out the k others, so ask for as many as the tree keeps
+    // cell sums can't leave the members out either, so the grid is scanned boid by boid whatever it was built for
+    if(m_Options.topological) {
+        m_KdTree.QueryNearest(x, y, z, KNN_MAX + 1, buffer);
+    } else if(m_Options.neighborSearch == NeighborSearch::Grid) {
+        m_Grid.QueryRadius(x, y, z, m_SearchRadius, buffer);
+    } else {
+        const std::vector<int>& found = SearchNeighbors(x, y, z, buffer);
+        if(&found != &buffer)
+            buffer.assign(found.begin(), found.end());
+    }
+
+    // counting its own members would cohere the super boid to its own centroid
+    buffer.erase(std::remove_if(buffer.begin(), buffer.end(), [this, index](int i) { return m_BoidSuper[i] == index; }), buffer.end());
+    if(m_Options.topological)
+        buffer.resize(std::min((int)buffer.size(), m_Options.topologicalCount));
+}
+
+#pragma endregion
@@ -0,0 +1,726 @@
+#pragma once
+
+#include "Math.h"
+#include "Utility.h"
+#include "ThreadPool.h"
+#include "FlockKernels.h"
+#include "PerfCounter.h"
+
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+
+#define BOUND_SIZE 50.0f
+#define BOID_COUNT_DEFAULT 100
+#define BOID_COUNT_MAX 1000000
+
+#pragma region aligned_array
+
+#define FLOCK_ALIGNMENT 64
+#define FLOCK_LINE_FLOATS (FLOCK_ALIGNMENT / (int)sizeof(float))
+
+// heap array aligned to FLOCK_ALIGNMENT so whole cache lines and vector loads stay in one lane
+template<typename T>
+class AlignedArray
+{
+public:
+    AlignedArray(void);
+    ~AlignedArray();
+
+    void Reserve(int capacity);
+    void Swap(AlignedArray& other);
+
+    T *GetData(void);
+    const T *GetData(void) const;
+    int GetCapacity(void) const;
+
+    T& operator[](int index);
+    T operator[](int index) const;
+
+private:
+    AlignedArray(const AlignedArray&) = delete;
+    AlignedArray& operator=(const AlignedArray&) = delete;
+
+private:
+    void *m_Allocation = nullptr;
+    T *m_Data = nullptr;
+    int m_Capacity = 0;
+};
+
+#pragma endregion
+
+#pragma region flock_store
+
+// structure of arrays boid storage, one contiguous lane per component
+// the lanes are a pool that only grows, removal moves the last boid into the hole so [0, count) stays dense
+class FlockStore
+{
+public:
+    FlockStore(void);
+    ~FlockStore();
+
+    void Resize(int count);
+    int Add(void);
+    void Remove(int index);
+    int GetCount(void) const;
+    int GetCapacity(void) const;
+
+    Point GetPosition(int index) const;
+    Vector GetVelocity(int index) const;
+    Vector GetForward(int index) const;
+    void SetPosition(int index, const Point& position);
+    void SetVelocity(int index, const Vector& velocity);
+    void SwapKinematics(FlockStore& other);
+    void Reorder(const std::vector<int>& order, FlockStore& scratch);
+    void SavePreviousPositions(void);
+    Point GetInterpolatedPosition(int index, float t) const;
+
+public:
+    AlignedArray<float> px, py, pz;
+    AlignedArray<float> vx, vy, vz;
+    AlignedArray<float> fx, fy, fz;
+    AlignedArray<float> ax, ay, az;
+
+    // steering acceleration from the last step the boid was steered, for staggered steps
+    AlignedArray<float> sx, sy, sz;
+
+    // position at the previous tick, for render interpolation
+    AlignedArray<float> ppx, ppy, ppz;
+
+    // fixed at spawn, indexes the flock's parameter blocks and interaction matrix
+    AlignedArray<int> species;
+
+private:
+    int m_Count = 0;
+};
+
+#pragma endregion
+
+#pragma region spatial_grid
+
+// aggregated grids use cells this many times finer than the search radius
+#define GRID_AGGREGATE_SUBDIVISION 4
+
+// so do the grids neighbor lists are built from, coarser since their queries only cull whole cells
+#define GRID_LIST_SUBDIVISION 2
+
+// cell pairs a 2x2x2 block owns, its lowest cell with itself and with the 13 neighbors that come after it
+#define GRID_BLOCK_PAIRS 14
+
+// two parities per axis plus a third for the last coord of a wrapped odd resolution
+#define GRID_BLOCK_COLORS 27
+
+// incrementally updated cells get this many free slots past a quarter more than they hold
+#define GRID_CELL_SLACK 4
+
+// uniform grid over the bound cube, rebuilt every step or updated in place
+// boids are counting-sorted by cell so a query only visits the 27 surrounding cells
+// a periodic grid wraps the cells on the far faces around instead of clamping
+class SpatialGrid
+{
+public:
+    SpatialGrid(void);
+    ~SpatialGrid();
+
+    // full counting sort, spread over the pool when given more than one thread
+    void Build(const FlockStore& store, float cellSize, bool periodic, ThreadPool& pool, int threadCount);
+
+    // moves only the boids whose cell changed since the last update, within free slots left in every cell
+    // falls back to a full build when the layout changed or a cell runs out of slots
+    void Update(const FlockStore& store, float cellSize, bool periodic, ThreadPool& pool, int threadCount);
+    void BuildAggregates(const FlockStore& store);
+
+    // renumbers the boids after the store was reordered, remap maps old indices to new ones
+    void Remap(const std::vector<int>& remap);
+
+    // drops the slots so the next update rebuilds, for boids added or removed behind the grid's back
+    // a count check alone misses a despawn followed by as many spawns
+    void Invalidate(void);
+    void Query(float x, float y, float z, std::vector<int>& neighbors) const;
+
+    // only the cells that reach within radius, worth it on grids built finer than the radius
+    void QueryRadius(float x, float y, float z, float radius, std::vector<int>& neighbors) const;
+
+    // visits every cell within radius, cells wholly inside farDistance and wholly outside nearDistance
+    // add their position and forward sums to far in one go, the rest append their boids to neighbors
+    void QueryAggregated(float x, float y, float z, float radius, float nearDistance, float farDistance,
+        std::vector<int>& neighbors, NeighborSums& far) const;
+
+    // lists the 2x2x2 windows of cells holding any boid, grouped by color so no two windows of a color share a cell
+    // a window owns the neighboring cell pairs whose lowest corner is its own lowest cell, so every pair comes up once
+    void BuildBlocks(void);
+    int GetBlockColorCount(void) const;
+    void GetBlockRange(int color, int& begin, int& end) const;
+
+    // the nonempty cell pairs the block owns, a pair of the same cell stands for the pairs within it
+    int GetBlockPairs(int block, int pairs[GRID_BLOCK_PAIRS][2]) const;
+    const int *GetCellBoids(int cell, int& count) const;
+    bool SupportsHalfShell(void) const;
+    int GetCellCount(void) const;
+
+    int GetResolution(void) const;
+    int GetMovedCount(void) const;
+    bool WasRebuilt(void) const;
+
+    // morton order of the cell a grid of this cell size would put the position in, no built grid needed
+    static unsigned int GetMortonKey(float x, float y, float z, float cellSize);
+
+private:
+    static int CellResolution(float cellSize);
+    void BuildCells(const FlockStore& store, float cellSize, bool periodic, ThreadPool& pool, int threadCount, bool slack);
+    int BoidCell(const FlockStore& store, int index) const;
+    int CellCoord(float value) const;
+    int CellIndex(int x, int y, int z) const;
+    int BlockColor(int cell) const;
+    void CellRange(int coord, int reach, int& first, int& last) const;
+
+private:
+    // the cells a query visits along one axis with the nearest image distances to them
+    struct AxisCells
+    {
+        int count = 0;
+        int cells[64];
+        float minSq[64], maxSq[64], shift[64];
+    };
+
+    void GetAxisCells(float value, int reach, AxisCells& axis) const;
+
+private:
+    // sums over the boids of one cell, counts come from the cell ranges
+    struct CellAggregate
+    {
+        float px = 0.0f, py = 0.0f, pz = 0.0f;
+        float fx = 0.0f, fy = 0.0f, fz = 0.0f;
+    };
+
+    int m_Resolution = 1;
+    bool m_Periodic = false;
+    float m_CellSize = BOUND_SIZE;
+
+    // cell c holds the boids in [m_CellStart[c], m_CellEnd[c]), slots up to m_CellStart[c + 1] are free
+    std::vector<int> m_CellStart;
+    std::vector<int> m_CellEnd;
+    std::vector<int> m_CellBoids;
+    std::vector<int> m_BoidCells;
+    std::vector<int> m_BoidSlots;
+    std::vector<int> m_NextCells;
+    std::vector<std::atomic<int>> m_CellCursors;
+    std::vector<CellAggregate> m_CellAggregates;
+
+    // windows in color order and in the order they were found, m_BlockMarks stays cleared between builds
+    std::vector<int> m_Blocks;
+    std::vector<int> m_BlockWindows;
+    std::vector<int> m_ColorStarts;
+    std::vector<unsigned char> m_BlockMarks;
+
+    bool m_Slack = false;
+    bool m_Rebuilt = false;
+    int m_Moved = 0;
+};
+
+#pragma endregion
+
+#pragma region spatial_octree
+
+#define OCTREE_LEAF_CAPACITY 32
+#define OCTREE_MAX_DEPTH 10
+
+// adaptive octree over the bound cube for clumped flocks, dense regions split finely and empty space stays one node
+// leaves split past OCTREE_LEAF_CAPACITY boids and merge back once their parent holds half that
+// updated in place every step, only boids that left their leaf are moved
+class SpatialOctree
+{
+public:
+    SpatialOctree(void);
+    ~SpatialOctree();
+
+    void Build(const FlockStore& store, float radius, bool periodic);
+    void Update(const FlockStore& store, float radius, bool periodic);
+    void Invalidate(void);
+    void Query(float x, float y, float z, std::vector<int>& neighbors) const;
+
+    int GetNodeCount(void) const;
+    int GetLeafCount(void) const;
+    int GetMovedCount(void) const;
+
+private:
+    struct Node
+    {
+        float x, y, z, half;
+        int parent = -1;
+        int depth = 0;
+        int children = -1;
+        int count = 0;
+        std::vector<int> boids;
+    };
+
+    int AllocateChildren(int node);
+    void FreeChildren(int node);
+    int FindLeaf(float x, float y, float z) const;
+    bool Contains(int node, float x, float y, float z) const;
+    static bool ContainsAxis(float value, float min, float max, float bound);
+    bool Overlaps(int node, float x, float y, float z) const;
+
+    void Insert(const FlockStore& store, int boid);
+    void Remove(int boid);
+    void Split(const FlockStore& store, int node);
+    void Collapse(int node);
+    void Gather(int node, std::vector<int>& boids);
+
+private:
+    // children come in blocks of 8 consecutive nodes, freed blocks are reused by index
+    std::vector<Node> m_Nodes;
+    std::vector<int> m_FreeBlocks;
+    std::vector<int> m_BoidLeaves;
+    std::vector<int> m_BoidSlots;
+
+    float m_Radius = 0.0f;
+    float m_MinHalf = 0.0f;
+    bool m_Periodic = false;
+    bool m_Valid = false;
+    int m_Moved = 0;
+};
+
+#pragma endregion
+
+#pragma region kd_tree
+
+#define KD_TREE_LEAF_SIZE 8
+#define KNN_MAX 32
+
+// balanced kd tree over the boid positions, rebuilt every step
+// answers k nearest neighbor queries in about log n + k work however dense the flock gets
+class KdTree
+{
+public:
+    KdTree(void);
+    ~KdTree();
+
+    void Build(const FlockStore& store, bool periodic);
+    void QueryNearest(float x, float y, float z, int count, std::vector<int>& neighbors) const;
+
+    int GetNodeCount(void) const;
+
+private:
+    struct Node
+    {
+        float min[3], max[3];
+        int begin, end;
+        int left = -1;
+    };
+
+    void BuildNode(int index, int begin, int end);
+    float BoxDistanceSq(const Node& node, const float point[3]) const;
+
+private:
+    const FlockStore *m_Store = nullptr;
+    std::vector<Node> m_Nodes;
+    std::vector<int> m_Indices;
+    bool m_Periodic = false;
+};
+
+#pragma endregion
+
+#pragma region flock
+
+// beyond this many cached pairs the lists fall back to searching every step
+#define NEIGHBOR_LIST_MAX_ENTRIES (32 << 20)
+
+enum class NeighborSearch
+{
+    BruteForce = 0,
+    Grid,
+    Octree
+};
+
+// every species has its own block, the search structures are sized for the largest distances of any
+struct FlockParams
+{
+    float maxSpeed = 0.8f;
+    float maxForce = 0.1f;
+    float mass = 20.0f;
+
+    float arrivalDistance = 5.0f;
+    float separateDistance = 2.0f;
+    float alignDistance = 10.0f;
+    float cohereDistance = 10.0f;
+
+    float separateWeight = 1.0f;
+    float alignWeight = 1.0f;
+    float cohereWeight = 1.0f;
+    float alphaAlignWeight = 0.2f;
+    float alphaCohereWeight = 0.2f;
+
+    float GetNeighborDistance(void) const;
+};
+
+struct FlockOptions
+{
+    NeighborSearch neighborSearch = NeighborSearch::Grid;
+
+    // neighbors see each other across the mirrored faces, matching the wrap in Flock::Mirror
+    bool periodic = true;
+    bool fusedSteering = true;
+    SimdLevel simdLevel = SimdLevel::Scalar;
+
+    // double buffered steps read step n and write step n + 1, so they can run on the thread pool
+    bool doubleBuffered = false;
+    int threadCount = 1;
+
+    // steps between re-sorting the store by species then morton order of the grid cell, 0 never sorts
+    // a flock of several species is still sorted once after every spawn so each species stays contiguous
+    int sortInterval = 16;
+
+    // verlet lists cache every boid's neighbors out to the search radius plus the skin
+    // and reuse them until some boid has moved more than half the skin
+    // the skin defaults to what lets boids at the top speed reuse the lists for listReuseSteps steps, a positive listSkin overrides it
+    bool neighborLists = false;
+    int listReuseSteps = 3;
+    float listSkin = 0.0f;
+
+    // topological mode aligns and coheres with the k nearest boids whatever their distance, separation stays metric
+    bool topological = false;
+    int topologicalCount = 7;
+
+    // the grid keeps per cell sums so cells wholly inside the align and cohere distances cost O(1)
+    // exact for double buffered steps, in place steps see those cells as they were at the start of the step
+    bool cellAggregates = false;
+
+    // split the flock into this many interleaved slices and steer one slice per step
+    // the others reuse their last steering, every boid still integrates every step
+    int steeringSlices = 1;
+
+    // move boids between grid cells in place instead of rebuilding the grid every step
+    bool incrementalGrid = false;
+
+    // double buffered steps can evaluate every separating pair once from a half shell of grid cells
+    // and push both boids apart with it, Separate is then skipped
+    // only used with unfused steering, the fused kernel separates in the pass it aligns and coheres in anyway
+    bool halfShellSeparation = false;
+
+    // boids farther than the far distance from the viewer are collapsed per cluster cell into super boids
+    // that steer once for all their members, they expand again once the viewer comes within the near distance
+    // members ride rigidly at their offsets, so every recluster interval steps all clusters are expanded and formed anew
+    bool lod = false;
+    float lodNearDistance = 50.0f;
+    float lodFarDistance = 70.0f;
+    float lodClusterSize = 5.0f;
+    int lodReclusterInterval = 32;
+};
+
+// how strongly a boid of the row's species separates from, aligns with and coheres to a neighbor of the column's
+// 1 treats the neighbor like its own kind, 0 ignores it
+struct SpeciesMatrix
+{
+    SpeciesMatrix(void);
+
+    float separate[SPECIES_MAX][SPECIES_MAX];
+    float align[SPECIES_MAX][SPECIES_MAX];
+    float cohere[SPECIES_MAX][SPECIES_MAX];
+};
+
+// counters for the last step
+// neighbor candidates counts the other boids the search handed to steering, not the pairs within neighbor distance
+// in place steps pad the search by the top speed and aggregated grids leave out the boids of summed cells, so it only compares within a mode
+// neighbor lines counts the lane cache lines the neighbor gathers touch, a hardware independent stand in for misses
+// cache misses covers the stepping thread only and is -1 when no hardware counter is available
+struct FlockStats
+{
+    long long neighborCandidates = 0;
+    long long neighborLines = 0;
+    long long cacheMisses = -1;
+
+    // time spent building or updating the neighbor search structures
+    double indexMs = 0.0;
+
+    // unordered pairs the half shell pass tested and how many of them were close enough to separate
+    long long separationTests = 0;
+    long long separationPairs = 0;
+};
+
+// per thread scratch, padded so counters of neighboring threads don't share a cache line
+struct FlockWorkspace
+{
+    std::vector<int> neighbors;
+    NeighborSums far;
+    std::vector<int> listNeighbors;
+    bool listOverflowed = false;
+    long long neighborCandidates = 0;
+    long long neighborLines = 0;
+    long long separationTests = 0;
+    long long separationPairs = 0;
+    char padding[FLOCK_ALIGNMENT];
+};
+
+// verlet list bookkeeping since the lists were turned on
+// saved compares every reuse step against the last step that rebuilt, so it goes negative when reuse doesn't pay
+struct NeighborListStats
+{
+    int steps = 0;
+    int rebuilds = 0;
+    bool rebuilt = false;
+    bool overflowed = false;
+
+    double buildMs = 0.0;
+    double checkMs = 0.0;
+    double rebuildStepMs = 0.0;
+    double reuseStepMs = 0.0;
+    double savedMs = 0.0;
+};
+
+// a distant cluster stepped as one boid, members keep their offset from its centroid
+struct SuperBoid
+{
+    int species;
+    Point position;
+    Vector velocity;
+    Vector forward;
+    std::vector<int> members;
+    std::vector<Vector> offsets;
+};
+
+struct LodStats
+{
+    int superBoids = 0;
+    int members = 0;
+    int collapsed = 0;
+    int expanded = 0;
+};
+
+struct AlphaState
+{
+    Point position;
+    Point previousPosition;
+    Vector velocity;
+    Vector forward = Vector(0.0f, 0.0f, -1.0f);
+    float pitch = 0.0f;
+    float yaw = 0.0f;
+    float speed = 0.4f;
+};
+
+class Flock
+{
+public:
+    Flock(void);
+    ~Flock();
+
+    void Init(int count);
+    void Step(void);
+
+    void SetCount(int count);
+    void Spawn(int count);
+    void Despawn(int count);
+
+    FlockStore& GetStore(void);
+    const FlockStore& GetStore(void) const;
+    FlockParams& GetParams(int species = 0);
+    FlockOptions& GetOptions(void);
+    SpeciesMatrix& GetInteraction(void);
+    AlphaState& GetAlpha(void);
+    const AlphaState& GetAlpha(void) const;
+    const SpatialGrid& GetGrid(void) const;
+    const SpatialOctree& GetOctree(void) const;
+    const KdTree& GetKdTree(void) const;
+    const FlockStats& GetStats(void) const;
+    const NeighborListStats& GetListStats(void) const;
+    int GetSortCount(void) const;
+    const std::vector<int>& GetSortRemap(void) const;
+    int GetMaxThreadCount(void) const;
+    const LodStats& GetLodStats(void) const;
+
+    // boids are dealt to the species round robin, changing the count deals every boid again
+    // new species start from a copy of the first one's parameters
+    void SetSpeciesCount(int count);
+    int GetSpeciesCount(void) const;
+
+    // false until the next step has sorted the store after boids were added or removed
+    bool GetSpeciesRange(int species, int& start, int& count) const;
+
+    // level of detail is measured from here, usually the camera
+    void SetViewer(const Point& viewer);
+
+    static Point Interpolate(const Point& previous, const Point& current, float t);
+    SimdLevel GetMaxSimdLevel(void) const;
+    const char *GetKernelName(void) const;
+
+private:
+    void StepBoid(int index, FlockStore& target, FlockWorkspace& workspace);
+    const std::vector<int>& QueryNeighbors(int index, std::vector<int>& buffer, NeighborSums& far);
+    const std::vector<int>& SearchNeighbors(float x, float y, float z, std::vector<int>& buffer);
+    void PrepareSearch(float radius, int subdivision);
+    bool UseCellAggregates(void) const;
+    const FlockParams& GetBoidParams(int index) const;
+    float GetMaxNeighborDistance(void) const;
+    float GetMaxSpeed(void) const;
+    bool IsInteractionUniform(void) const;
+    void PrepareQuery(NeighborQuery& query, int species, const FlockParams& params) const;
+
+    float GetListSkin(void) const;
+    void UpdateNeighborLists(float radius);
+    void BuildNeighborLists(float radius);
+    void BuildNeighborList(int index, float radius, FlockWorkspace& workspace);
+    Vector GetListDrift(void) const;
+    bool ListsMoved(const Vector& drift, float distance) const;
+
+    void SeparateHalfShell(void);
+    void SeparateBlock(int block, FlockWorkspace& workspace);
+    void SeparatePair(int first, int second, FlockWorkspace& workspace);
+    void AccumulateSeparation(int index, int neighbor, const Vector& desired);
+
+    void Separate(int index, const std::vector<int>& neighbors);
+    void Align(int index, const std::vector<int>& neighbors, const NeighborSums& far);
+    void Cohere(int index, const std::vector<int>& neighbors, const NeighborSums& far);
+    void SteerFused(int index, const std::vector<int>& neighbors, const NeighborSums& far);
+
+    Vector MinimumImage(const Vector& offset) const;
+    void Steer(int index, const Vector& desired, float weight);
+    void Seek(int index, const Point& target, float speed, float weight);
+    void Integrate(int index, FlockStore& target);
+    void UpdateAlpha(void);
+    void SortBoids(void);
+    void ResetBoid(int index);
+
+    void UpdateLod(void);
+    void CollapseFar(void);
+    void ExpandNear(void);
+    void ExpandAll(void);
+    void RemapSuperBoids(void);
+    void StepSuperBoid(int index, FlockStore& target, FlockWorkspace& workspace);
+    void QueryNeighborsAt(int index, std::vector<int>& buffer);
+    Vector SteerForce(const FlockParams& params, const Vector& desired, const Vector& velocity, float weight) const;
+    Vector SeekForce(const FlockParams& params, const Point& position, const Vector& velocity, const Point& target, float speed, float weight) const;
+
+    static void Mirror(float& x, float& y, float& z);
+
+private:
+    FlockStore m_Store;
+    FlockStore m_NextStore;
+    FlockParams m_Params[SPECIES_MAX];
+    FlockOptions m_Options;
+    AlphaState m_Alpha;
+    FlockStats m_Stats;
+    SimdLevel m_MaxSimdLevel;
+    int m_SteeringPhase = 0;
+
+    SpatialGrid m_Grid;
+    SpatialGrid m_SeparationGrid;
+    bool m_HalfShell = false;
+    SpatialOctree m_Octree;
+    KdTree m_KdTree;
+    std::vector<int> m_AllBoids;
+    float m_SearchRadius = 0.0f;
+
+    ThreadPool m_ThreadPool;
+    std::vector<FlockWorkspace> m_Workspaces;
+    PerfCounter m_CacheMissCounter;
+
+    // morton sort state, the remap maps indices before the last sort to indices after it
+    int m_StepsUntilSort = 0;
+    int m_SortCount = 0;
+    std::vector<uint64_t> m_SortKeys;
+    std::vector<int> m_SortOrder;
+    std::vector<int> m_SortRemap;
+
+    // species occupy [m_SpeciesStart[s], m_SpeciesStart[s + 1]) while m_SpeciesSorted
+    // mixed means some interaction factor isn't 1, so the kernels have to look up the neighbors' species
+    int m_SpeciesCount = 1;
+    SpeciesMatrix m_Interaction;
+    bool m_SpeciesSorted = true;
+    bool m_MixedSpecies = false;
+    int m_SpeciesStart[SPECIES_MAX + 1];
+
+    // verlet lists live in the workspace of the thread that built them
+    // boid i owns m_ListCount[i] entries from m_ListStart[i] in the list of workspace m_ListThread[i]
+    bool m_ListsValid = false;
+    float m_ListRadius = 0.0f;
+    bool m_ListPeriodic = false;
+    std::vector<int> m_ListStart;
+    std::vector<int> m_ListCount;
+    std::vector<int> m_ListThread;
+    // positions at the last rebuild and the flock's mean displacement since
+    std::vector<float> m_ListX, m_ListY, m_ListZ;
+    Vector m_ListDrift;
+    NeighborListStats m_ListStats;
+
+    // m_BoidSuper[i] is the super boid boid i belongs to, -1 while it steers on its own
+    Point m_Viewer;
+    std::vector<SuperBoid> m_SuperBoids;
+    std::vector<int> m_BoidSuper;
+    std::vector<uint64_t> m_LodKeys;
+    int m_StepsUntilRecluster = 0;
+    LodStats m_LodStats;
+};
+
+#pragma endregion
+
+#pragma region aligned_array_impl
+
+template<typename T>
+AlignedArray<T>::AlignedArray(void) {}
+
+template<typename T>
+AlignedArray<T>::~AlignedArray()
+{
+    free(m_Allocation);
+}
+
+template<typename T>
+void AlignedArray<T>::Reserve(int capacity)
+{
+    if(capacity <= m_Capacity)
+        return;
+
+    // over-allocate and round the data pointer up to the alignment
+    void *allocation = malloc(capacity * sizeof(T) + FLOCK_ALIGNMENT);
+    uintptr_t address = ((uintptr_t)allocation + FLOCK_ALIGNMENT - 1) & ~(uintptr_t)(FLOCK_ALIGNMENT - 1);
+    T *data = (T *)address;
+
+    if(m_Data != nullptr)
+        std::copy(m_Data, m_Data + m_Capacity, data);
+    free(m_Allocation);
+
+    m_Allocation = allocation;
+    m_Data = data;
+    m_Capacity = capacity;
+}
+
+template<typename T>
+void AlignedArray<T>::Swap(AlignedArray& other)
+{
+    std::swap(m_Allocation, other.m_Allocation);
+    std::swap(m_Data, other.m_Data);
+    std::swap(m_Capacity, other.m_Capacity);
+}
+
+template<typename T>
+T *AlignedArray<T>::GetData(void)
+{
+    return m_Data;
+}
+
+template<typename T>
+const T *AlignedArray<T>::GetData(void) const
+{
+    return m_Data;
+}
+
+template<typename T>
+int AlignedArray<T>::GetCapacity(void) const
+{
+    return m_Capacity;
+}
+
+template<typename T>
+T& AlignedArray<T>::operator[](int index)
+{
+    return m_Data[index];
+}
+
+template<typename T>
+T AlignedArray<T>::operator[](int index) const
+{
+    return m_Data[index];
+}
+
+#pragma endregion
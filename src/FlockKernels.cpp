@@ -0,0 +1,287 @@
+#include "FlockKernels.h"
+
+#include "Utility.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define FLOCK_KERNELS_X86
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+#pragma region scalar_kernel
+
+void AccumulateNeighborsScalar(const NeighborQuery& query, const int *neighbors, int count, NeighborSums& sums)
+{
+    for(int n = 0; n < count; n++) {
+        int i = neighbors[n];
+        if(i == query.self)
+            continue;
+
+        float dx = query.x - query.px[i];
+        float dy = query.y - query.py[i];
+        float dz = query.z - query.pz[i];
+
+        // minimum image, the shift is exactly zero when the bound isn't periodic
+        float shiftX = query.period * rintf(dx * query.inversePeriod);
+        float shiftY = query.period * rintf(dy * query.inversePeriod);
+        float shiftZ = query.period * rintf(dz * query.inversePeriod);
+        dx -= shiftX;
+        dy -= shiftY;
+        dz -= shiftZ;
+
+        float distanceSq = dx * dx + dy * dy + dz * dz;
+
+        float separateFactor = 1.0f, alignFactor = 1.0f, cohereFactor = 1.0f;
+        if(query.species != nullptr) {
+            int species = query.species[i];
+            separateFactor = query.separateFactors[species];
+            alignFactor = query.alignFactors[species];
+            cohereFactor = query.cohereFactors[species];
+        }
+
+        if(distanceSq <= query.separateDistanceSq) {
+            // desired push away from the neighbor, Vector::Normalize falls back to +x for a zero offset
+            float distance = sqrtf(distanceSq);
+            float dirX = 1.0f, dirY = 0.0f, dirZ = 0.0f;
+            if(distance >= EPSILON) {
+                dirX = dx / distance;
+                dirY = dy / distance;
+                dirZ = dz / distance;
+            }
+            float scale = Clamp(query.separateDistance / distance, 0.0f, query.maxSpeed);
+
+            // steering force towards it, clamped the same way as Flock::Steer
+            float forceX = scale * dirX - query.vx;
+            float forceY = scale * dirY - query.vy;
+            float forceZ = scale * dirZ - query.vz;
+            float force = sqrtf(forceX * forceX + forceY * forceY + forceZ * forceZ);
+            if(force > query.maxForce) {
+                float clamp = query.maxForce * query.separateWeight / force;
+                forceX *= clamp;
+                forceY *= clamp;
+                forceZ *= clamp;
+            }
+
+            sums.separateX += separateFactor * forceX;
+            sums.separateY += separateFactor * forceY;
+            sums.separateZ += separateFactor * forceZ;
+        }
+
+        if(distanceSq <= query.alignDistanceSq) {
+            sums.forwardX += alignFactor * query.fx[i];
+            sums.forwardY += alignFactor * query.fy[i];
+            sums.forwardZ += alignFactor * query.fz[i];
+        }
+
+        // the centroid is weighted by the factor, so a neighbor of a factor 0 species doesn't count at all
+        if(distanceSq <= query.cohereDistanceSq) {
+            sums.centerX += cohereFactor * (query.px[i] + shiftX);
+            sums.centerY += cohereFactor * (query.py[i] + shiftY);
+            sums.centerZ += cohereFactor * (query.pz[i] + shiftZ);
+            sums.cohereWeight += cohereFactor;
+        }
+    }
+}
+
+#pragma endregion
+
+#pragma region dispatch
+
+#ifdef FLOCK_KERNELS_X86
+
+static void CpuId(int leaf, int subleaf, unsigned int registers[4])
+{
+#if defined(_MSC_VER)
+    int values[4];
+    __cpuidex(values, leaf, subleaf);
+    for(int i = 0; i < 4; i++)
+        registers[i] = (unsigned int)values[i];
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+static unsigned long long GetExtendedControlRegister(void)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+#endif
+
+SimdLevel DetectSimdLevel(void)
+{
+#ifdef FLOCK_KERNELS_X86
+    unsigned int registers[4];
+    CpuId(0, 0, registers);
+    int maxLeaf = (int)registers[0];
+
+    CpuId(1, 0, registers);
+    bool sse41 = registers[2] & BIT(19);
+    bool osxsave = registers[2] & BIT(27);
+    bool avx = registers[2] & BIT(28);
+
+    // avx registers are only usable when the os saves the ymm state
+    bool avx2 = false;
+    if(maxLeaf >= 7 && osxsave && avx && (GetExtendedControlRegister() & 0x6) == 0x6) {
+        CpuId(7, 0, registers);
+        avx2 = registers[1] & BIT(5);
+    }
+
+    if(avx2)
+        return SimdLevel::AVX2;
+    if(sse41)
+        return SimdLevel::SSE41;
+#endif
+    return SimdLevel::Scalar;
+}
+
+NeighborKernel GetNeighborKernel(SimdLevel level)
+{
+    switch(level) {
+#ifdef FLOCK_KERNELS_X86
+        case SimdLevel::AVX2:
+            return AccumulateNeighborsAVX2;
+        case SimdLevel::SSE41:
+            return AccumulateNeighborsSSE41;
+#endif
+        default:
+            return AccumulateNeighborsScalar;
+    }
+}
+
+const char *GetSimdLevelName(SimdLevel level)
+{
+    switch(level) {
+        case SimdLevel::AVX2:   return "AVX2";
+        case SimdLevel::SSE41:  return "SSE4.1";
+        default:                return "Scalar";
+    }
+}
+
+#pragma endregion
+
+#pragma region validation
+
+#define KERNEL_VALIDATION_BOIDS 257
+#define KERNEL_VALIDATION_ROUNDS 64
+#define KERNEL_VALIDATION_TOLERANCE 1e-4f
+
+static float NextValidationRandom(unsigned int& state, float min, float max)
+{
+    // local lcg so validation doesn't disturb the rand() sequence used to seed the flock
+    state = state * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(state >> 8) / (float)(1 << 24);
+}
+
+static bool MatchSums(const NeighborSums& result, const NeighborSums& reference)
+{
+    const float *values = &result.separateX;
+    const float *expected = &reference.separateX;
+    for(int i = 0; i < 10; i++) {
+        if(fabs(values[i] - expected[i]) > KERNEL_VALIDATION_TOLERANCE * std::max(1.0f, (float)fabs(expected[i])))
+            return false;
+    }
+    return true;
+}
+
+SimdLevel ValidateNeighborKernels(SimdLevel maxLevel)
+{
+    unsigned int state = 12345u;
+    std::vector<float> lanes[6];
+    for(std::vector<float>& lane : lanes)
+        lane.resize(KERNEL_VALIDATION_BOIDS);
+    std::vector<int> neighbors(KERNEL_VALIDATION_BOIDS);
+    std::vector<int> species(KERNEL_VALIDATION_BOIDS);
+    float factors[3][SPECIES_MAX];
+
+    SimdLevel validLevel = maxLevel;
+    for(int round = 0; round < KERNEL_VALIDATION_ROUNDS; round++) {
+        // random cluster around the origin, some duplicates to hit the zero offset case
+        // odd rounds wrap the cluster as a 12 unit periodic cube
+        for(int i = 0; i < KERNEL_VALIDATION_BOIDS; i++) {
+            for(int c = 0; c < 3; c++)
+                lanes[c][i] = NextValidationRandom(state, -6.0f, 6.0f);
+            for(int c = 3; c < 6; c++)
+                lanes[c][i] = NextValidationRandom(state, -1.0f, 1.0f);
+            neighbors[i] = i;
+            species[i] = (int)NextValidationRandom(state, 0.0f, (float)SPECIES_MAX) % SPECIES_MAX;
+        }
+        for(int f = 0; f < 3; f++) {
+            for(int s = 0; s < SPECIES_MAX; s++)
+                factors[f][s] = NextValidationRandom(state, 0.0f, 2.0f);
+        }
+        lanes[0][1] = lanes[0][0];
+        lanes[1][1] = lanes[1][0];
+        lanes[2][1] = lanes[2][0];
+        std::reverse(neighbors.begin() + round, neighbors.end());
+
+        NeighborQuery query;
+        query.px = lanes[0].data();
+        query.py = lanes[1].data();
+        query.pz = lanes[2].data();
+        query.fx = lanes[3].data();
+        query.fy = lanes[4].data();
+        query.fz = lanes[5].data();
+        query.self = round % KERNEL_VALIDATION_BOIDS;
+        query.x = lanes[0][0];
+        query.y = lanes[1][0];
+        query.z = lanes[2][0];
+        query.vx = NextValidationRandom(state, -0.8f, 0.8f);
+        query.vy = NextValidationRandom(state, -0.8f, 0.8f);
+        query.vz = NextValidationRandom(state, -0.8f, 0.8f);
+        query.period = round % 2 ? 12.0f : 0.0f;
+        query.inversePeriod = round % 2 ? 1.0f / 12.0f : 0.0f;
+        query.separateDistance = 2.0f + round * 0.05f;
+        query.separateDistanceSq = query.separateDistance * query.separateDistance;
+        query.alignDistanceSq = 25.0f;
+        query.cohereDistanceSq = 36.0f;
+        query.maxSpeed = 0.8f;
+        query.maxForce = 0.1f;
+        query.separateWeight = 1.0f + round * 0.01f;
+
+        // every other pair of rounds mixes species
+        if(round % 4 >= 2) {
+            query.species = species.data();
+            query.separateFactors = factors[0];
+            query.alignFactors = factors[1];
+            query.cohereFactors = factors[2];
+        }
+
+        int count = KERNEL_VALIDATION_BOIDS - round;
+        NeighborSums reference;
+        AccumulateNeighborsScalar(query, neighbors.data(), count, reference);
+
+        for(int level = (int)SimdLevel::SSE41; level <= (int)validLevel; level++) {
+            NeighborSums result;
+            GetNeighborKernel((SimdLevel)level)(query, neighbors.data(), count, result);
+            if(!MatchSums(result, reference)) {
+                validLevel = (SimdLevel)(level - 1);
+                break;
+            }
+        }
+    }
+
+    return validLevel;
+}
+
+SimdLevel GetSupportedSimdLevel(void)
+{
+    // thread safe one time initialization, every flock after the first reuses the result
+    static const SimdLevel s_Level = ValidateNeighborKernels(DetectSimdLevel());
+    return s_Level;
+}
+
+#pragma endregion
@@ -0,0 +1,66 @@
+#pragma once
+
+// neighbor accumulation kernels for the fused steering path
+// every variant produces the same sums, the vector ones just test 4 or 8 neighbors per instruction
+
+// a row of the species interaction matrix fills one avx register
+#define SPECIES_MAX 8
+
+enum class SimdLevel
+{
+    Scalar = 0,
+    SSE41,
+    AVX2
+};
+
+// the boid being steered, the flock lanes it reads and the steering limits
+struct NeighborQuery
+{
+    const float *px, *py, *pz;
+    const float *fx, *fy, *fz;
+    int self;
+
+    float x, y, z;
+    float vx, vy, vz;
+
+    // offsets wrap to the nearest image when period is the bound size, 0 leaves them euclidean
+    float period, inversePeriod;
+
+    // the species lane and the steering boid's rows of the interaction matrix, indexed by the neighbor's species
+    // separate and align factors scale a neighbor's contribution, cohere moves the summed position
+    // that fraction of the way from the boid to the neighbor, null species weighs every neighbor 1
+    const int *species = nullptr;
+    const float *separateFactors = nullptr, *alignFactors = nullptr, *cohereFactors = nullptr;
+
+    float separateDistance, separateDistanceSq;
+    float alignDistanceSq, cohereDistanceSq;
+    float maxSpeed, maxForce, separateWeight;
+};
+
+// separate holds the sum of the clamped per-neighbor separation steering forces
+// center sums the neighbor images nearest to the queried boid, each scaled by its cohere factor
+// cohereWeight sums those factors, so it counts the neighbors while every factor is 1
+struct NeighborSums
+{
+    float separateX = 0.0f, separateY = 0.0f, separateZ = 0.0f;
+    float forwardX = 0.0f, forwardY = 0.0f, forwardZ = 0.0f;
+    float centerX = 0.0f, centerY = 0.0f, centerZ = 0.0f;
+    float cohereWeight = 0.0f;
+};
+
+typedef void (*NeighborKernel)(const NeighborQuery& query, const int *neighbors, int count, NeighborSums& sums);
+
+void AccumulateNeighborsScalar(const NeighborQuery& query, const int *neighbors, int count, NeighborSums& sums);
+void AccumulateNeighborsSSE41(const NeighborQuery& query, const int *neighbors, int count, NeighborSums& sums);
+void AccumulateNeighborsAVX2(const NeighborQuery& query, const int *neighbors, int count, NeighborSums& sums);
+
+SimdLevel DetectSimdLevel(void);
+NeighborKernel GetNeighborKernel(SimdLevel level);
+const char *GetSimdLevelName(SimdLevel level);
+
+// runs every supported kernel on random neighborhoods and compares against the scalar sums
+// returns the highest level that matched within tolerance
+SimdLevel ValidateNeighborKernels(SimdLevel maxLevel);
+
+// the widest level the cpu supports that also validated, checked on the first call and cached for the process
+SimdLevel GetSupportedSimdLevel(void);
@@ -0,0 +1,137 @@
+#include "FlockKernels.h"
+
+#include "Utility.h"
+
+// compiled with -mavx2, only called when DetectSimdLevel reports support
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+static float HorizontalSum(__m256 wide)
+{
+    __m128 value = _mm_add_ps(_mm256_castps256_ps128(wide), _mm256_extractf128_ps(wide, 1));
+    __m128 shuffled = _mm_movehdup_ps(value);
+    __m128 sums = _mm_add_ps(value, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+
+void AccumulateNeighborsAVX2(const NeighborQuery& query, const int *neighbors, int count, NeighborSums& sums)
+{
+    const __m256 x = _mm256_set1_ps(query.x), y = _mm256_set1_ps(query.y), z = _mm256_set1_ps(query.z);
+    const __m256 vx = _mm256_set1_ps(query.vx), vy = _mm256_set1_ps(query.vy), vz = _mm256_set1_ps(query.vz);
+    const __m256 separateDistance = _mm256_set1_ps(query.separateDistance);
+    const __m256 separateDistanceSq = _mm256_set1_ps(query.separateDistanceSq);
+    const __m256 alignDistanceSq = _mm256_set1_ps(query.alignDistanceSq);
+    const __m256 cohereDistanceSq = _mm256_set1_ps(query.cohereDistanceSq);
+    const __m256 maxSpeed = _mm256_set1_ps(query.maxSpeed);
+    const __m256 maxForce = _mm256_set1_ps(query.maxForce);
+    const __m256 clampedForce = _mm256_set1_ps(query.maxForce * query.separateWeight);
+    const __m256 epsilon = _mm256_set1_ps((float)EPSILON);
+    const __m256 period = _mm256_set1_ps(query.period), inversePeriod = _mm256_set1_ps(query.inversePeriod);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    const __m256i self = _mm256_set1_epi32(query.self);
+
+    // one permute looks up eight neighbors' factors in the row
+    const bool mixed = query.species != nullptr;
+    const __m256 separateRow = mixed ? _mm256_loadu_ps(query.separateFactors) : one;
+    const __m256 alignRow = mixed ? _mm256_loadu_ps(query.alignFactors) : one;
+    const __m256 cohereRow = mixed ? _mm256_loadu_ps(query.cohereFactors) : one;
+
+    __m256 separateX = zero, separateY = zero, separateZ = zero;
+    __m256 forwardX = zero, forwardY = zero, forwardZ = zero;
+    __m256 centerX = zero, centerY = zero, centerZ = zero;
+    __m256 cohereWeight = zero;
+
+    int n = 0;
+    for(; n + 8 <= count; n += 8) {
+        const int *i = neighbors + n;
+        __m256i indices = _mm256_loadu_si256((const __m256i *)i);
+        __m256 notSelf = _mm256_castsi256_ps(_mm256_cmpeq_epi32(indices, self));
+        notSelf = _mm256_xor_ps(notSelf, _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+
+        __m256 px = _mm256_i32gather_ps(query.px, indices, 4);
+        __m256 py = _mm256_i32gather_ps(query.py, indices, 4);
+        __m256 pz = _mm256_i32gather_ps(query.pz, indices, 4);
+        __m256 dx = _mm256_sub_ps(x, px), dy = _mm256_sub_ps(y, py), dz = _mm256_sub_ps(z, pz);
+
+        // minimum image
+        __m256 shiftX = _mm256_mul_ps(period, _mm256_round_ps(_mm256_mul_ps(dx, inversePeriod), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        __m256 shiftY = _mm256_mul_ps(period, _mm256_round_ps(_mm256_mul_ps(dy, inversePeriod), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        __m256 shiftZ = _mm256_mul_ps(period, _mm256_round_ps(_mm256_mul_ps(dz, inversePeriod), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        dx = _mm256_sub_ps(dx, shiftX);
+        dy = _mm256_sub_ps(dy, shiftY);
+        dz = _mm256_sub_ps(dz, shiftZ);
+        __m256 distanceSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+        __m256 separateFactor = one, alignFactor = one, cohereFactor = one;
+        if(mixed) {
+            __m256i species = _mm256_i32gather_epi32(query.species, indices, 4);
+            separateFactor = _mm256_permutevar8x32_ps(separateRow, species);
+            alignFactor = _mm256_permutevar8x32_ps(alignRow, species);
+            cohereFactor = _mm256_permutevar8x32_ps(cohereRow, species);
+        }
+
+        // separate
+        __m256 separateMask = _mm256_and_ps(_mm256_cmp_ps(distanceSq, separateDistanceSq, _CMP_LE_OQ), notSelf);
+        if(_mm256_movemask_ps(separateMask)) {
+            __m256 distance = _mm256_sqrt_ps(distanceSq);
+            __m256 degenerate = _mm256_cmp_ps(distance, epsilon, _CMP_LT_OQ);
+            __m256 dirX = _mm256_blendv_ps(_mm256_div_ps(dx, distance), one, degenerate);
+            __m256 dirY = _mm256_blendv_ps(_mm256_div_ps(dy, distance), zero, degenerate);
+            __m256 dirZ = _mm256_blendv_ps(_mm256_div_ps(dz, distance), zero, degenerate);
+            __m256 scale = _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(separateDistance, distance), zero), maxSpeed);
+
+            __m256 forceX = _mm256_sub_ps(_mm256_mul_ps(scale, dirX), vx);
+            __m256 forceY = _mm256_sub_ps(_mm256_mul_ps(scale, dirY), vy);
+            __m256 forceZ = _mm256_sub_ps(_mm256_mul_ps(scale, dirZ), vz);
+            __m256 force = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(forceX, forceX), _mm256_mul_ps(forceY, forceY)), _mm256_mul_ps(forceZ, forceZ)));
+            __m256 clamp = _mm256_blendv_ps(one, _mm256_div_ps(clampedForce, force), _mm256_cmp_ps(force, maxForce, _CMP_GT_OQ));
+            clamp = _mm256_mul_ps(clamp, separateFactor);
+
+            separateX = _mm256_add_ps(separateX, _mm256_and_ps(_mm256_mul_ps(forceX, clamp), separateMask));
+            separateY = _mm256_add_ps(separateY, _mm256_and_ps(_mm256_mul_ps(forceY, clamp), separateMask));
+            separateZ = _mm256_add_ps(separateZ, _mm256_and_ps(_mm256_mul_ps(forceZ, clamp), separateMask));
+        }
+
+        // align
+        __m256 alignMask = _mm256_and_ps(_mm256_cmp_ps(distanceSq, alignDistanceSq, _CMP_LE_OQ), notSelf);
+        if(_mm256_movemask_ps(alignMask)) {
+            __m256 fx = _mm256_i32gather_ps(query.fx, indices, 4);
+            __m256 fy = _mm256_i32gather_ps(query.fy, indices, 4);
+            __m256 fz = _mm256_i32gather_ps(query.fz, indices, 4);
+            forwardX = _mm256_add_ps(forwardX, _mm256_and_ps(_mm256_mul_ps(fx, alignFactor), alignMask));
+            forwardY = _mm256_add_ps(forwardY, _mm256_and_ps(_mm256_mul_ps(fy, alignFactor), alignMask));
+            forwardZ = _mm256_add_ps(forwardZ, _mm256_and_ps(_mm256_mul_ps(fz, alignFactor), alignMask));
+        }
+
+        // cohere
+        __m256 cohereMask = _mm256_and_ps(_mm256_cmp_ps(distanceSq, cohereDistanceSq, _CMP_LE_OQ), notSelf);
+        __m256 imageX = _mm256_add_ps(px, shiftX), imageY = _mm256_add_ps(py, shiftY), imageZ = _mm256_add_ps(pz, shiftZ);
+        if(mixed) {
+            imageX = _mm256_mul_ps(imageX, cohereFactor);
+            imageY = _mm256_mul_ps(imageY, cohereFactor);
+            imageZ = _mm256_mul_ps(imageZ, cohereFactor);
+        }
+        centerX = _mm256_add_ps(centerX, _mm256_and_ps(imageX, cohereMask));
+        centerY = _mm256_add_ps(centerY, _mm256_and_ps(imageY, cohereMask));
+        centerZ = _mm256_add_ps(centerZ, _mm256_and_ps(imageZ, cohereMask));
+        cohereWeight = _mm256_add_ps(cohereWeight, _mm256_and_ps(cohereFactor, cohereMask));
+    }
+
+    sums.separateX += HorizontalSum(separateX);
+    sums.separateY += HorizontalSum(separateY);
+    sums.separateZ += HorizontalSum(separateZ);
+    sums.forwardX += HorizontalSum(forwardX);
+    sums.forwardY += HorizontalSum(forwardY);
+    sums.forwardZ += HorizontalSum(forwardZ);
+    sums.centerX += HorizontalSum(centerX);
+    sums.centerY += HorizontalSum(centerY);
+    sums.centerZ += HorizontalSum(centerZ);
+    sums.cohereWeight += HorizontalSum(cohereWeight);
+
+    // remainder
+    AccumulateNeighborsScalar(query, neighbors + n, count - n, sums);
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "FlockKernels.h"
+
+#include "Utility.h"
+
+// compiled with -msse4.1, only called when DetectSimdLevel reports support
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#include <smmintrin.h>
+
+static float HorizontalSum(__m128 value)
+{
+    __m128 shuffled = _mm_movehdup_ps(value);
+    __m128 sums = _mm_add_ps(value, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+
+void AccumulateNeighborsSSE41(const NeighborQuery& query, const int *neighbors, int count, NeighborSums& sums)
+{
+    const __m128 x = _mm_set1_ps(query.x), y = _mm_set1_ps(query.y), z = _mm_set1_ps(query.z);
+    const __m128 vx = _mm_set1_ps(query.vx), vy = _mm_set1_ps(query.vy), vz = _mm_set1_ps(query.vz);
+    const __m128 separateDistance = _mm_set1_ps(query.separateDistance);
+    const __m128 separateDistanceSq = _mm_set1_ps(query.separateDistanceSq);
+    const __m128 alignDistanceSq = _mm_set1_ps(query.alignDistanceSq);
+    const __m128 cohereDistanceSq = _mm_set1_ps(query.cohereDistanceSq);
+    const __m128 maxSpeed = _mm_set1_ps(query.maxSpeed);
+    const __m128 maxForce = _mm_set1_ps(query.maxForce);
+    const __m128 clampedForce = _mm_set1_ps(query.maxForce * query.separateWeight);
+    const __m128 epsilon = _mm_set1_ps((float)EPSILON);
+    const __m128 period = _mm_set1_ps(query.period), inversePeriod = _mm_set1_ps(query.inversePeriod);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const __m128i self = _mm_set1_epi32(query.self);
+    const bool mixed = query.species != nullptr;
+
+    __m128 separateX = zero, separateY = zero, separateZ = zero;
+    __m128 forwardX = zero, forwardY = zero, forwardZ = zero;
+    __m128 centerX = zero, centerY = zero, centerZ = zero;
+    __m128 cohereWeight = zero;
+
+    int n = 0;
+    for(; n + 4 <= count; n += 4) {
+        const int *i = neighbors + n;
+        __m128i indices = _mm_loadu_si128((const __m128i *)i);
+        __m128 notSelf = _mm_castsi128_ps(_mm_cmpeq_epi32(indices, self));
+        notSelf = _mm_xor_ps(notSelf, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+        __m128 px = _mm_set_ps(query.px[i[3]], query.px[i[2]], query.px[i[1]], query.px[i[0]]);
+        __m128 py = _mm_set_ps(query.py[i[3]], query.py[i[2]], query.py[i[1]], query.py[i[0]]);
+        __m128 pz = _mm_set_ps(query.pz[i[3]], query.pz[i[2]], query.pz[i[1]], query.pz[i[0]]);
+        __m128 dx = _mm_sub_ps(x, px), dy = _mm_sub_ps(y, py), dz = _mm_sub_ps(z, pz);
+
+        // minimum image
+        __m128 shiftX = _mm_mul_ps(period, _mm_round_ps(_mm_mul_ps(dx, inversePeriod), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        __m128 shiftY = _mm_mul_ps(period, _mm_round_ps(_mm_mul_ps(dy, inversePeriod), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        __m128 shiftZ = _mm_mul_ps(period, _mm_round_ps(_mm_mul_ps(dz, inversePeriod), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        dx = _mm_sub_ps(dx, shiftX);
+        dy = _mm_sub_ps(dy, shiftY);
+        dz = _mm_sub_ps(dz, shiftZ);
+        __m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+        __m128 separateFactor = one, alignFactor = one, cohereFactor = one;
+        if(mixed) {
+            const int *s = query.species;
+            separateFactor = _mm_set_ps(query.separateFactors[s[i[3]]], query.separateFactors[s[i[2]]], query.separateFactors[s[i[1]]], query.separateFactors[s[i[0]]]);
+            alignFactor = _mm_set_ps(query.alignFactors[s[i[3]]], query.alignFactors[s[i[2]]], query.alignFactors[s[i[1]]], query.alignFactors[s[i[0]]]);
+            cohereFactor = _mm_set_ps(query.cohereFactors[s[i[3]]], query.cohereFactors[s[i[2]]], query.cohereFactors[s[i[1]]], query.cohereFactors[s[i[0]]]);
+        }
+
+        // separate
+        __m128 separateMask = _mm_and_ps(_mm_cmple_ps(distanceSq, separateDistanceSq), notSelf);
+        if(_mm_movemask_ps(separateMask)) {
+            __m128 distance = _mm_sqrt_ps(distanceSq);
+            __m128 degenerate = _mm_cmplt_ps(distance, epsilon);
+            __m128 dirX = _mm_blendv_ps(_mm_div_ps(dx, distance), one, degenerate);
+            __m128 dirY = _mm_blendv_ps(_mm_div_ps(dy, distance), zero, degenerate);
+            __m128 dirZ = _mm_blendv_ps(_mm_div_ps(dz, distance), zero, degenerate);
+            __m128 scale = _mm_min_ps(_mm_max_ps(_mm_div_ps(separateDistance, distance), zero), maxSpeed);
+
+            __m128 forceX = _mm_sub_ps(_mm_mul_ps(scale, dirX), vx);
+            __m128 forceY = _mm_sub_ps(_mm_mul_ps(scale, dirY), vy);
+            __m128 forceZ = _mm_sub_ps(_mm_mul_ps(scale, dirZ), vz);
+            __m128 force = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(forceX, forceX), _mm_mul_ps(forceY, forceY)), _mm_mul_ps(forceZ, forceZ)));
+            __m128 clamp = _mm_blendv_ps(one, _mm_div_ps(clampedForce, force), _mm_cmpgt_ps(force, maxForce));
+            clamp = _mm_mul_ps(clamp, separateFactor);
+
+            separateX = _mm_add_ps(separateX, _mm_and_ps(_mm_mul_ps(forceX, clamp), separateMask));
+            separateY = _mm_add_ps(separateY, _mm_and_ps(_mm_mul_ps(forceY, clamp), separateMask));
+            separateZ = _mm_add_ps(separateZ, _mm_and_ps(_mm_mul_ps(forceZ, clamp), separateMask));
+        }
+
+        // align
+        __m128 alignMask = _mm_and_ps(_mm_cmple_ps(distanceSq, alignDistanceSq), notSelf);
+        if(_mm_movemask_ps(alignMask)) {
+            __m128 fx = _mm_set_ps(query.fx[i[3]], query.fx[i[2]], query.fx[i[1]], query.fx[i[0]]);
+            __m128 fy = _mm_set_ps(query.fy[i[3]], query.fy[i[2]], query.fy[i[1]], query.fy[i[0]]);
+            __m128 fz = _mm_set_ps(query.fz[i[3]], query.fz[i[2]], query.fz[i[1]], query.fz[i[0]]);
+            forwardX = _mm_add_ps(forwardX, _mm_and_ps(_mm_mul_ps(fx, alignFactor), alignMask));
+            forwardY = _mm_add_ps(forwardY, _mm_and_ps(_mm_mul_ps(fy, alignFactor), alignMask));
+            forwardZ = _mm_add_ps(forwardZ, _mm_and_ps(_mm_mul_ps(fz, alignFactor), alignMask));
+        }
+
+        // cohere
+        __m128 cohereMask = _mm_and_ps(_mm_cmple_ps(distanceSq, cohereDistanceSq), notSelf);
+        __m128 imageX = _mm_add_ps(px, shiftX), imageY = _mm_add_ps(py, shiftY), imageZ = _mm_add_ps(pz, shiftZ);
+        if(mixed) {
+            imageX = _mm_mul_ps(imageX, cohereFactor);
+            imageY = _mm_mul_ps(imageY, cohereFactor);
+            imageZ = _mm_mul_ps(imageZ, cohereFactor);
+        }
+        centerX = _mm_add_ps(centerX, _mm_and_ps(imageX, cohereMask));
+        centerY = _mm_add_ps(centerY, _mm_and_ps(imageY, cohereMask));
+        centerZ = _mm_add_ps(centerZ, _mm_and_ps(imageZ, cohereMask));
+        cohereWeight = _mm_add_ps(cohereWeight, _mm_and_ps(cohereFactor, cohereMask));
+    }
+
+    sums.separateX += HorizontalSum(separateX);
+    sums.separateY += HorizontalSum(separateY);
+    sums.separateZ += HorizontalSum(separateZ);
+    sums.forwardX += HorizontalSum(forwardX);
+    sums.forwardY += HorizontalSum(forwardY);
+    sums.forwardZ += HorizontalSum(forwardZ);
+    sums.centerX += HorizontalSum(centerX);
+    sums.centerY += HorizontalSum(centerY);
+    sums.centerZ += HorizontalSum(centerZ);
+    sums.cohereWeight += HorizontalSum(cohereWeight);
+
+    // remainder
+    AccumulateNeighborsScalar(query, neighbors + n, count - n, sums);
+}
+
+#endif
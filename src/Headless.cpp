@@ -0,0 +1,39 @@
+#include "Headless.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+
+int RunHeadless(const HeadlessConfig& config)
+{
+    srand(config.seed);
+
+    Flock flock;
+    if(config.threadCount > 0) {
+        flock.GetOptions().doubleBuffered = true;
+        flock.GetOptions().threadCount = config.threadCount;
+    }
+    flock.Init(config.boidCount);
+
+    int threads = flock.GetOptions().doubleBuffered ? std::min(flock.GetOptions().threadCount, flock.GetMaxThreadCount()) : 1;
+    std::cout << "HEADLESS: " << flock.GetStore().GetCount() << " boids, " << config.steps << " steps, " << threads << " threads, " << flock.GetKernelName() << " kernel" << std::endl;
+
+    // step
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int i = 0; i < config.steps; i++)
+        flock.Step();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    // report
+    double totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+    double stepMs = config.steps > 0 ? totalMs / config.steps : 0.0;
+    double boidNs = flock.GetStore().GetCount() > 0 ? stepMs * 1e6 / flock.GetStore().GetCount() : 0.0;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  total: " << totalMs << " ms" << std::endl;
+    std::cout << "  step: " << stepMs << " ms" << std::endl;
+    std::cout << "  boid step: " << boidNs << " ns" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Flock.h"
+
+// runs the flock without a window or gl context and prints step timing
+struct HeadlessConfig
+{
+    int boidCount = BOID_COUNT_DEFAULT;
+    int steps = 1000;
+    int threadCount = 0;
+    unsigned int seed = 0;
+};
+
+int RunHeadless(const HeadlessConfig& config);
@@ -1,14 +1,48 @@
+#include "Headless.h"
+
+#ifndef FLOCK_HEADLESS_ONLY
 #include "Simulation.h"
+#endif
 
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 
-int main(void)
+int main(int argc, char **argv)
 {
     srand(time(NULL));
 
-    Simulation app;
+    // parse arguments
+    HeadlessConfig config;
+    config.seed = (unsigned int)time(NULL);
+
+    // the headless only build has no window to fall back to
+#ifdef FLOCK_HEADLESS_ONLY
+    bool headless = true;
+#else
+    bool headless = false;
+#endif
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if(strcmp(argv[i], "--boids") == 0 && i + 1 < argc)
+            config.boidCount = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+            config.steps = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            config.threadCount = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            config.seed = (unsigned int)atoi(argv[++i]);
+    }
+
+    // no window, gl context or imgui
+    if(headless)
+        return RunHeadless(config);
+
+#ifndef FLOCK_HEADLESS_ONLY
+    Simulation app(config.boidCount);
     app.Run();
+#endif
 
     return 0;
 }
\ No newline at end of file
@@ -321,4 +321,190 @@ Matrix4 Matrix4::Ortho(float left, float right, float bottom, float top, float n
     return Matrix4(result);
 }
 
+#pragma endregion
+
+#pragma region affine_transform
+
+AffineTransform::AffineTransform(void)
+{
+    *this = AffineTransform::Identity();
+}
+
+AffineTransform::AffineTransform(const Matrix4& matrix)
+{
+    std::copy(matrix.GetData(), matrix.GetData() + 12, m_Data);
+}
+
+AffineTransform AffineTransform::Identity(void)
+{
+    AffineTransform result(Matrix4::Identity());
+    return result;
+}
+
+AffineTransform AffineTransform::Translate(float x, float y, float z)
+{
+    AffineTransform result;
+    result[0][3] = x;
+    result[1][3] = y;
+    result[2][3] = z;
+    return result;
+}
+
+AffineTransform AffineTransform::Scale(float x, float y, float z)
+{
+    AffineTransform result;
+    result[0][0] = x;
+    result[1][1] = y;
+    result[2][2] = z;
+    return result;
+}
+
+AffineTransform AffineTransform::RotateX(float a)
+{
+    a = DEG_TO_RAD(a);
+    AffineTransform result;
+    float sinA = sinf(a);
+    float cosA = cosf(a);
+    result[1][1] = cosA;
+    result[1][2] = -sinA;
+    result[2][1] = sinA;
+    result[2][2] = cosA;
+    return result;
+}
+
+AffineTransform AffineTransform::RotateY(float a)
+{
+    a = DEG_TO_RAD(a);
+    AffineTransform result;
+    float sinA = sinf(a);
+    float cosA = cosf(a);
+    result[0][0] = cosA;
+    result[0][2] = sinA;
+    result[2][0] = -sinA;
+    result[2][2] = cosA;
+    return result;
+}
+
+AffineTransform AffineTransform::RotateZ(float a)
+{
+    a = DEG_TO_RAD(a);
+    AffineTransform result;
+    float sinA = sinf(a);
+    float cosA = cosf(a);
+    result[0][0] = cosA;
+    result[0][1] = -sinA;
+    result[1][0] = sinA;
+    result[1][1] = cosA;
+    return result;
+}
+
+AffineTransform AffineTransform::Invert(const AffineTransform& transform)
+{
+    float det = transform.Determinant();
+    if(Equal(det, 0.0f))
+        return AffineTransform::Identity();
+
+    // adjugate over the determinant for the 3x3 part, then the translation undone through it
+    const AffineTransform& m = transform;
+    AffineTransform result;
+    result[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) / det;
+    result[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) / det;
+    result[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) / det;
+    result[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) / det;
+    result[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) / det;
+    result[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) / det;
+    result[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) / det;
+    result[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) / det;
+    result[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) / det;
+    for(int i = 0; i < 3; i++)
+        result[i][3] = -(result[i][0] * m[0][3] + result[i][1] * m[1][3] + result[i][2] * m[2][3]);
+    return result;
+}
+
+AffineTransform& AffineTransform::Invert(void)
+{
+    *this = AffineTransform::Invert(*this);
+    return *this;
+}
+
+float AffineTransform::Determinant(void) const
+{
+    const AffineTransform& m = *this;
+    return  m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+            m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+            m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+Matrix4 AffineTransform::GetNormalMatrix(void) const
+{
+    float det = Determinant();
+    if(Equal(det, 0.0f))
+        return Matrix4::Identity();
+
+    // the inverse transpose is the cofactor matrix over the determinant
+    const AffineTransform& m = *this;
+    float normal[] = {
+        (m[1][1] * m[2][2] - m[1][2] * m[2][1]) / det,
+        (m[1][2] * m[2][0] - m[1][0] * m[2][2]) / det,
+        (m[1][0] * m[2][1] - m[1][1] * m[2][0]) / det,
+        0.0f,
+        (m[0][2] * m[2][1] - m[0][1] * m[2][2]) / det,
+        (m[0][0] * m[2][2] - m[0][2] * m[2][0]) / det,
+        (m[0][1] * m[2][0] - m[0][0] * m[2][1]) / det,
+        0.0f,
+        (m[0][1] * m[1][2] - m[0][2] * m[1][1]) / det,
+        (m[0][2] * m[1][0] - m[0][0] * m[1][2]) / det,
+        (m[0][0] * m[1][1] - m[0][1] * m[1][0]) / det,
+        0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f
+    };
+    return Matrix4(normal);
+}
+
+Matrix4 AffineTransform::ToMatrix4(void) const
+{
+    Matrix4 result = Matrix4::Identity();
+    std::copy(m_Data, m_Data + 12, &result[0][0]);
+    return result;
+}
+
+AffineTransform AffineTransform::operator*(const AffineTransform& rhs) const
+{
+    AffineTransform result;
+    for(int i = 0; i < 3; i++) {
+        for(int j = 0; j < 4; j++) {
+            result[i][j] = 0.0f;
+            for(int k = 0; k < 3; k++) {
+                result[i][j] += (*this)[i][k] * rhs[k][j];
+            }
+        }
+        result[i][3] += (*this)[i][3];
+    }
+    return result;
+}
+
+Tuple AffineTransform::operator*(const Tuple& rhs) const
+{
+    Tuple result;
+    for(int i = 0; i < 3; i++) {
+        result[i] = 0.0f;
+        for(int j = 0; j < 3; j++) {
+            result[i] += (*this)[i][j] * rhs[j];
+        }
+        result[i] += (*this)[i][3] * rhs.w;
+    }
+    result.w = rhs.w;
+    return result;
+}
+
+MatrixRow<4> AffineTransform::operator[](int index)
+{
+    return MatrixRow<4>(m_Data + index * 4);
+}
+
+const MatrixRow<4> AffineTransform::operator[](int index) const
+{
+    return MatrixRow<4>(m_Data + index * 4);
+}
+
 #pragma endregion
\ No newline at end of file
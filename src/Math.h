@@ -362,4 +362,39 @@ std::ostream& operator<<(std::ostream& out, const Matrix<size>& rhs)
 
 #pragma endregion
 
-#pragma endregion
\ No newline at end of file
+#pragma endregion
+#pragma region affine_transform
+
+// a 3x4 matrix with an implied 0 0 0 1 bottom row, for rotation, scale and translation chains
+// products sum in the same order as Matrix4, so swapping one for the other gives identical floats
+class AffineTransform
+{
+public:
+    AffineTransform(void);
+    explicit AffineTransform(const Matrix4& matrix);
+
+    static AffineTransform Identity(void);
+    static AffineTransform Translate(float x, float y, float z);
+    static AffineTransform Scale(float x, float y, float z);
+    static AffineTransform RotateX(float a);
+    static AffineTransform RotateY(float a);
+    static AffineTransform RotateZ(float a);
+    static AffineTransform Invert(const AffineTransform& transform);
+
+    AffineTransform& Invert(void);
+    float Determinant(void) const;
+
+    // inverse transpose of the 3x3 part, the translation doesn't move normals
+    Matrix4 GetNormalMatrix(void) const;
+    Matrix4 ToMatrix4(void) const;
+
+    AffineTransform operator*(const AffineTransform& rhs) const;
+    Tuple operator*(const Tuple& rhs) const;
+    MatrixRow<4> operator[](int index);
+    const MatrixRow<4> operator[](int index) const;
+
+private:
+    float m_Data[12];
+};
+
+#pragma endregion
@@ -0,0 +1,75 @@
+#include "PerfCounter.h"
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <cstring>
+#endif
+
+PerfCounter::PerfCounter(void) {}
+
+PerfCounter::~PerfCounter()
+{
+    Close();
+}
+
+bool PerfCounter::Open(void)
+{
+    Close();
+
+#if defined(__linux__)
+    perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    m_Descriptor = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+
+    return IsAvailable();
+}
+
+void PerfCounter::Close(void)
+{
+#if defined(__linux__)
+    if(m_Descriptor >= 0)
+        close(m_Descriptor);
+#endif
+    m_Descriptor = -1;
+}
+
+void PerfCounter::Start(void)
+{
+#if defined(__linux__)
+    if(m_Descriptor >= 0) {
+        ioctl(m_Descriptor, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_Descriptor, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+long long PerfCounter::Stop(void)
+{
+    long long count = -1;
+
+#if defined(__linux__)
+    if(m_Descriptor >= 0) {
+        ioctl(m_Descriptor, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(m_Descriptor, &count, sizeof(count)) != sizeof(count))
+            count = -1;
+    }
+#endif
+
+    return count;
+}
+
+bool PerfCounter::IsAvailable(void) const
+{
+    return m_Descriptor >= 0;
+}
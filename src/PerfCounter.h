@@ -0,0 +1,24 @@
+#pragma once
+
+// hardware cache miss counter for the calling thread
+// backed by perf_event_open on linux, reports unavailable everywhere else or when the kernel refuses it
+class PerfCounter
+{
+public:
+    PerfCounter(void);
+    ~PerfCounter();
+
+    bool Open(void);
+    void Close(void);
+    void Start(void);
+    long long Stop(void);
+
+    bool IsAvailable(void) const;
+
+private:
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+private:
+    int m_Descriptor = -1;
+};
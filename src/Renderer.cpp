@@ -1,6 +1,8 @@
 #include "Renderer.h"
 
 #include <iostream>
+#include <cstring>
+#include <algorithm>
 
 #include <glad/glad.h>
 
@@ -38,31 +40,143 @@ Renderer::Renderer(void)
 
 Renderer::~Renderer() {}
 
+#define RENDERER_FRAME_BINDING 0
+void Renderer::Init(void)
+{
+    m_FrameBuffer.Init(sizeof(FrameUniforms), RENDERER_FRAME_BINDING);
+}
+
+static void CopyColor(float *dest, const Color& color)
+{
+    dest[0] = color.r;
+    dest[1] = color.g;
+    dest[2] = color.b;
+    dest[3] = 0.0f;
+}
+
 void Renderer::BeginScene(void)
 {
-    for(std::vector<Shader *>::iterator it = m_Shaders.begin(); it != m_Shaders.end(); it++) {
-        (*it)->Bind();
-        if((*it)->GetFlag(ShaderFlag::NoTranslateView))
-            (*it)->SetUniformMat4("u_View", m_Camera->GetNoTranslateView());
-        else
-            (*it)->SetUniformMat4("u_View", m_Camera->GetView());
-        (*it)->SetUniformMat4("u_Projection", m_Camera->GetProjection());
+    m_FrameStats = Primitive::GetStats();
+    m_StreamStalls += m_FrameStats.streamStalls;
+    Primitive::GetStats() = RenderStats();
+    m_View = AffineTransform(m_Camera->GetView());
+
+    // one upload per frame, however many shaders read it
+    FrameUniforms frame;
+    std::memcpy(frame.view, m_Camera->GetView().GetData(), sizeof(frame.view));
+    std::memcpy(frame.noTranslateView, m_Camera->GetNoTranslateView().GetData(), sizeof(frame.noTranslateView));
+    std::memcpy(frame.projection, m_Camera->GetProjection().GetData(), sizeof(frame.projection));
+    CopyColor(frame.lightAmbient, m_Light.ambient);
+    CopyColor(frame.lightDiffuse, m_Light.diffuse);
+    CopyColor(frame.lightSpecular, m_Light.specular);
+    frame.lightDirection[0] = m_Light.direction.x;
+    frame.lightDirection[1] = m_Light.direction.y;
+    frame.lightDirection[2] = m_Light.direction.z;
+    frame.lightDirection[3] = 0.0f;
+    m_FrameBuffer.SetData(&frame, sizeof(frame));
+}
+
+#pragma region render_queue
+
+#define RENDERER_SORT_DEPTH_MAX 200.0f
+#define RENDERER_SORT_DEPTH_BITS 24
+#define RENDERER_SORT_ID_MASK 0xFFFF
+
+void Renderer::Submit(const Mesh& mesh, const AffineTransform& model, const Material *material)
+{
+    // distance in front of the camera from the view row and the model's translation
+    float depth = -(m_View[2][0] * model[0][3] + m_View[2][1] * model[1][3] + m_View[2][2] * model[2][3] + m_View[2][3]);
+    PushCommand({ &mesh, material, model, false }, depth);
+}
+
+void Renderer::SubmitInstanced(const Mesh& mesh, const Material *material)
+{
+    PushCommand({ &mesh, material, AffineTransform::Identity(), true }, 0.0f);
+}
+
+void Renderer::PushCommand(const RenderCommand& command, float depth)
+{
+    // materials are numbered in first-submitted order, enough to group equal ones
+    std::unordered_map<const Material *, int>::iterator it = m_MaterialIds.find(command.material);
+    if(it == m_MaterialIds.end())
+        it = m_MaterialIds.insert({ command.material, (int)m_MaterialIds.size() }).first;
+
+    unsigned long long depthBits = (unsigned long long)(Clamp(depth / RENDERER_SORT_DEPTH_MAX, 0.0f, 1.0f) * ((1 << RENDERER_SORT_DEPTH_BITS) - 1));
+    unsigned long long key =
+        (unsigned long long)(command.mesh->GetShader()->GetId() & 0xFF) << 56 |
+        (unsigned long long)(it->second & RENDERER_SORT_ID_MASK) << 40 |
+        (unsigned long long)(command.mesh->GetVertexArrayId(command.instanced) & RENDERER_SORT_ID_MASK) << 24 |
+        depthBits;
+
+    m_Keys.push_back({ key, (int)m_Commands.size() });
+    m_Commands.push_back(command);
+}
+
+void Renderer::Flush(void)
+{
+    // submission order breaks ties so a frame always draws the same way
+    std::sort(m_Keys.begin(), m_Keys.end(), [](const RenderKey& lhs, const RenderKey& rhs) {
+        return lhs.key != rhs.key ? lhs.key < rhs.key : lhs.command < rhs.command;
+    });
+
+    for(const RenderKey& key : m_Keys)
+        Draw(m_Commands[key.command]);
+
+    m_Commands.clear();
+    m_Keys.clear();
+    m_MaterialIds.clear();
+}
+
+void Renderer::DrawMesh(const Mesh& mesh, const AffineTransform& model)
+{
+    Draw({ &mesh, nullptr, model, false });
+}
+
+void Renderer::DrawMeshInstanced(const Mesh& mesh)
+{
+    Draw({ &mesh, nullptr, AffineTransform::Identity(), true });
+}
+
+void Renderer::Draw(const RenderCommand& command)
+{
+    // binds and uniforms skip themselves when the state is already current
+    const Mesh& mesh = *command.mesh;
+    Shader *shader = mesh.GetShader();
+    const ShaderUniforms& uniforms = shader->GetUniforms();
+    shader->Bind();
+    if(command.material != nullptr)
+        shader->SetMaterial(*command.material);
+
+    if(command.instanced) {
+        // the shader builds each model and normal matrix from the instance attributes
+        mesh.BindInstanced();
+        shader->SetInstanced(true);
+        glDrawArraysInstanced(mesh.GetMode(), 0, mesh.GetVertexCount(), mesh.GetInstanceCount());
+    } else {
+        mesh.Bind();
+        if(shader->GetFlag(ShaderFlag::Model))
+            shader->SetUniform(uniforms.model, command.model.ToMatrix4());
+        if(shader->GetFlag(ShaderFlag::NormalMatrix))
+            shader->SetUniform(uniforms.normalMat, (m_View * command.model).GetNormalMatrix());
+        if(shader->GetFlag(ShaderFlag::Instanced))
+            shader->SetInstanced(false);
+        glDrawArrays(mesh.GetMode(), 0, mesh.GetVertexCount());
     }
+    Primitive::GetStats().drawCalls++;
+}
+
+const RenderStats& Renderer::GetFrameStats(void) const
+{
+    return m_FrameStats;
 }
 
-void Renderer::DrawMesh(const Mesh& mesh, const Matrix4& model)
+int Renderer::GetStreamStallCount(void) const
 {
-    mesh.GetShader()->Bind();
-    mesh.Bind();
-    if(mesh.GetShader()->GetFlag(ShaderFlag::Model))
-        mesh.GetShader()->SetUniformMat4("u_Model", model);
-    if(mesh.GetShader()->GetFlag(ShaderFlag::NormalMatrix))
-        mesh.GetShader()->SetUniformMat4("u_NormalMat", Matrix4::Transpose(Matrix4::Invert(m_Camera->GetView() * model)));
-    glDrawArrays(mesh.GetMode(), 0, mesh.GetVertexCount());
-    
-    mesh.Unbind();
+    return m_StreamStalls;
 }
 
+#pragma endregion
+
 void Renderer::Clear(const Color& color)
 {
     glClearColor(color.r, color.g, color.b, color.a);
@@ -73,7 +187,7 @@ void Renderer::Clear(const Color& color)
 
 void Renderer::AddShader(Shader *shader)
 {
-    m_Shaders.push_back(shader);
+    shader->BindUniformBlock("Frame", RENDERER_FRAME_BINDING);
 }
 
 #pragma region setters
@@ -83,4 +197,9 @@ void Renderer::SetCamera(Camera *camera)
     m_Camera = camera;
 }
 
+void Renderer::SetDirLight(const DirLight& light)
+{
+    m_Light = light;
+}
+
 #pragma endregion
\ No newline at end of file
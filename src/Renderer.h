@@ -3,6 +3,9 @@
 #include "RenderingPrimitives.h"
 #include "Math.h"
 
+#include <vector>
+#include <unordered_map>
+
 class Camera
 {
 public:
@@ -20,6 +23,34 @@ protected:
     Matrix4 m_Projection;
 };
 
+// std140 image of the Frame block every shader declares, matrices are row major like Matrix4
+struct FrameUniforms
+{
+    float view[16];
+    float noTranslateView[16];
+    float projection[16];
+    float lightAmbient[4];
+    float lightDiffuse[4];
+    float lightSpecular[4];
+    float lightDirection[4];
+};
+
+// a queued draw, instanced ones read the mesh's instance buffer when the queue flushes
+struct RenderCommand
+{
+    const Mesh *mesh;
+    const Material *material;
+    AffineTransform model;
+    bool instanced;
+};
+
+// shader, material, mesh and view depth from the high bits down, so sorting groups state changes
+struct RenderKey
+{
+    unsigned long long key;
+    int command;
+};
+
 class Renderer
 {
 public:
@@ -31,14 +62,40 @@ public:
     Renderer(void);
     ~Renderer();
 
+    void Init(void);
     void BeginScene(void);
-    void DrawMesh(const Mesh &mesh, const Matrix4& model);
     void Clear(const Color& color);
 
+    // queued draws are sorted by key and drawn on flush
+    void Submit(const Mesh &mesh, const AffineTransform& model, const Material *material = nullptr);
+    void SubmitInstanced(const Mesh &mesh, const Material *material = nullptr);
+    void Flush(void);
+
+    // immediate draws for passes that depend on order, like stencil outlines and the skybox
+    void DrawMesh(const Mesh &mesh, const AffineTransform& model);
+    void DrawMeshInstanced(const Mesh &mesh);
+
+    // counters for the last finished frame
+    const RenderStats& GetFrameStats(void) const;
+    int GetStreamStallCount(void) const;
+
     void SetCamera(Camera *camera);
+    void SetDirLight(const DirLight& light);
     void AddShader(Shader *shader);
 
+private:
+    void Draw(const RenderCommand& command);
+    void PushCommand(const RenderCommand& command, float depth);
+
 private:
     Camera *m_Camera;
-    std::vector<Shader *> m_Shaders;
+    AffineTransform m_View;
+    DirLight m_Light;
+    UniformBuffer m_FrameBuffer;
+
+    std::vector<RenderCommand> m_Commands;
+    std::vector<RenderKey> m_Keys;
+    std::unordered_map<const Material *, int> m_MaterialIds;
+    RenderStats m_FrameStats;
+    int m_StreamStalls = 0;
 };
\ No newline at end of file
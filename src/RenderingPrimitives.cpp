@@ -5,12 +5,20 @@
 #include <sstream>
 #include <string>
 #include <numeric>
+#include <cstring>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <stb_image.h>
 
 #pragma region primitive
 
+RenderStats Primitive::s_Stats;
+RenderStats& Primitive::GetStats(void)
+{
+    return s_Stats;
+}
+
 Primitive::Primitive(void) {}
 Primitive::~Primitive() {}
 
@@ -24,6 +32,11 @@ void Primitive::DeleteBuffer(void)
     glDeleteBuffers(1, &m_Id);
 }
 
+unsigned int Primitive::GetId(void) const
+{
+    return m_Id;
+}
+
 int Primitive::GetCount(void) const
 {
     return m_Count;
@@ -54,31 +67,172 @@ void VertexBuffer::BufferData(float *data, int vertexCount, const std::vector<in
 {
     // buffer data
     int stride = std::accumulate(layout.begin(), layout.end(), 0);
-    GenerateBuffer();
+    if(!m_Initialized)
+        GenerateBuffer();
     Bind();
     glBufferData(GL_ARRAY_BUFFER, stride * vertexCount * sizeof(float), (void *)data, GL_STATIC_DRAW);
 
     // set layout
-    int offset = 0;
+    SetLayout(layout);
+
+    m_Count = vertexCount;
+    m_Initialized = true;
+}
+
+void VertexBuffer::SetLayout(const std::vector<int>& layout, int firstAttribute, int divisor, int offset) const
+{
+    // expects this buffer and the target vertex array to be bound, offset is in bytes
+    int stride = std::accumulate(layout.begin(), layout.end(), 0);
+    int attributeOffset = 0;
     for(int i = 0; i < layout.size(); i++) {
-        glVertexAttribPointer(i, layout[i], GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(offset * sizeof(float)));
-        glEnableVertexAttribArray(i);
-        offset += layout[i];
+        glVertexAttribPointer(firstAttribute + i, layout[i], GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(offset + attributeOffset * sizeof(float)));
+        glEnableVertexAttribArray(firstAttribute + i);
+        glVertexAttribDivisor(firstAttribute + i, divisor);
+        attributeOffset += layout[i];
+    }
+}
+
+// segments start on a boundary any attribute offset accepts
+#define STREAM_BUFFER_ALIGN 256
+#define STREAM_BUFFER_WAIT_NS 1000000
+
+StreamBuffer::StreamBuffer(void) {}
+StreamBuffer::~StreamBuffer()
+{
+    DeleteFences();
+}
+
+int StreamBuffer::Write(const float *data, int vertexCount, int stride)
+{
+    int size = stride * vertexCount * sizeof(float);
+    if(!m_Initialized || size > m_SegmentSize)
+        Allocate(std::max(size, 2 * m_SegmentSize));
+
+    // the commands since the last write are what read the last segment
+    if(m_Written)
+        m_Fences[m_Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_Segment = (m_Segment + 1) % STREAM_BUFFER_SEGMENTS;
+    WaitSegment(m_Segment);
+
+    // unsynchronized, the fence already says nothing reads this range
+    int offset = m_Segment * m_SegmentSize;
+    Bind();
+    if(size > 0) {
+        void *dest = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if(dest != NULL) {
+            std::memcpy(dest, data, size);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        } else {
+            std::cout << "BUFFER::ERROR: failed to map stream buffer segment" << std::endl;
+        }
     }
 
     m_Count = vertexCount;
+    m_Written = true;
+    s_Stats.streamWrites++;
+    return offset;
+}
+
+int StreamBuffer::GetStallCount(void) const
+{
+    return m_StallCount;
+}
+
+void StreamBuffer::Allocate(int segmentSize)
+{
+    // respecifying the store orphans the old one, draws still reading it keep their copy
+    m_SegmentSize = (segmentSize + STREAM_BUFFER_ALIGN - 1) / STREAM_BUFFER_ALIGN * STREAM_BUFFER_ALIGN;
+    if(!m_Initialized) {
+        GenerateBuffer();
+        m_Initialized = true;
+    }
+    Bind();
+    glBufferData(GL_ARRAY_BUFFER, STREAM_BUFFER_SEGMENTS * m_SegmentSize, NULL, GL_STREAM_DRAW);
+
+    DeleteFences();
+    m_Segment = 0;
+    m_Written = false;
+}
+
+void StreamBuffer::WaitSegment(int segment)
+{
+    GLsync fence = (GLsync)m_Fences[segment];
+    if(fence == nullptr)
+        return;
+
+    // only a fence that isn't signaled yet counts as a stall
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if(status == GL_TIMEOUT_EXPIRED) {
+        m_StallCount++;
+        s_Stats.streamStalls++;
+        do {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_BUFFER_WAIT_NS);
+        } while(status == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(fence);
+    m_Fences[segment] = nullptr;
+}
+
+void StreamBuffer::DeleteFences(void)
+{
+    for(int i = 0; i < STREAM_BUFFER_SEGMENTS; i++) {
+        if(m_Fences[i] != nullptr)
+            glDeleteSync((GLsync)m_Fences[i]);
+        m_Fences[i] = nullptr;
+    }
+}
+
+UniformBuffer::UniformBuffer(void) {}
+UniformBuffer::~UniformBuffer()
+{
+    if(m_Initialized)
+        DeleteBuffer();
+}
+
+void UniformBuffer::Bind(void) const
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, m_Id);
+}
+
+void UniformBuffer::Unbind(void) const
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::Init(int size, unsigned int binding)
+{
+    GenerateBuffer();
+    Bind();
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_Id);
+    Unbind();
+
+    m_Count = size;
     m_Initialized = true;
 }
 
+void UniformBuffer::SetData(const void *data, int size, int offset)
+{
+    Bind();
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    Unbind();
+}
+
 #pragma endregion
 
 #pragma region vertex_array
 
+unsigned int VertexArray::s_Bound = 0;
+
 VertexArray::VertexArray(void) {}
 VertexArray::~VertexArray()
 {
-    if(m_Initialized)
-        glDeleteVertexArrays(1, &m_Id);
+    if(!m_Initialized)
+        return;
+    if(s_Bound == m_Id)
+        s_Bound = 0;
+    glDeleteVertexArrays(1, &m_Id);
 }
 
 void VertexArray::Init(void)
@@ -89,12 +243,21 @@ void VertexArray::Init(void)
 
 void VertexArray::Bind(void) const
 {
+    if(s_Bound == m_Id) {
+        s_Stats.vertexArrayBindsSkipped++;
+        return;
+    }
     glBindVertexArray(m_Id);
+    s_Bound = m_Id;
+    s_Stats.vertexArrayBinds++;
 }
 
 void VertexArray::Unbind(void) const
 {
+    if(s_Bound == 0)
+        return;
     glBindVertexArray(0);
+    s_Bound = 0;
 }
 
 #pragma endregion
@@ -123,7 +286,7 @@ void Mesh::InitData(const char *path, const std::vector<int>& layout, unsigned i
         return;
     }
 
-    int attributeCount, vertexCount, length;
+    int attributeCount, vertexCount, length = 0;
     std::vector<float> vertices;
     float attribute;
 
@@ -144,12 +307,48 @@ void Mesh::InitData(float *vertices, int vertexCount, const std::vector<int>& la
 {
     m_Mode = mode;
     m_Shader = shader;
+    m_Layout = layout;
     m_VertexArray.Init();
     m_VertexArray.Bind();
     m_VertexBuffer.BufferData(vertices, vertexCount, layout);
     m_VertexArray.Unbind();
 }
 
+void Mesh::InitInstances(const std::vector<int>& layout)
+{
+    m_InstanceLayout = layout;
+    m_InstanceStride = std::accumulate(layout.begin(), layout.end(), 0);
+    m_InstanceArray.Init();
+    m_InstanceArray.Bind();
+
+    // same vertices, the instance attributes are pointed at a segment on every write
+    m_VertexBuffer.Bind();
+    m_VertexBuffer.SetLayout(m_Layout);
+
+    m_InstanceArray.Unbind();
+}
+
+void Mesh::SetInstances(const float *instances, int instanceCount)
+{
+    int offset = m_InstanceBuffer.Write(instances, instanceCount, m_InstanceStride);
+
+    // one step of the segment per instance
+    m_InstanceArray.Bind();
+    m_InstanceBuffer.SetLayout(m_InstanceLayout, m_Layout.size(), 1, offset);
+    m_InstanceArray.Unbind();
+    m_InstanceBuffer.Unbind();
+}
+
+void Mesh::BindInstanced(void) const
+{
+    m_InstanceArray.Bind();
+}
+
+unsigned int Mesh::GetVertexArrayId(bool instanced) const
+{
+    return instanced ? m_InstanceArray.GetId() : m_VertexArray.GetId();
+}
+
 unsigned int Mesh::GetMode(void) const
 {
     return m_Mode;
@@ -165,6 +364,11 @@ int Mesh::GetVertexCount(void) const
     return m_VertexBuffer.GetCount();
 }
 
+int Mesh::GetInstanceCount(void) const
+{
+    return m_InstanceBuffer.GetCount();
+}
+
 void Mesh::SetShader(Shader *shader)
 {
     m_Shader = shader;
@@ -242,23 +446,37 @@ bool Material::operator==(const Material& rhs) const
             shininess == rhs.shininess;
 }
 
+unsigned int Shader::s_Bound = 0;
+
 Shader::Shader(unsigned char flags)
     : m_Flags(flags) {}
 
 Shader::~Shader()
 {
-    if(m_Initialized)
-        glDeleteProgram(m_Id);
+    if(!m_Initialized)
+        return;
+    if(s_Bound == m_Id)
+        s_Bound = 0;
+    glDeleteProgram(m_Id);
 }
 
 void Shader::Bind(void) const
 {
+    if(s_Bound == m_Id) {
+        s_Stats.programBindsSkipped++;
+        return;
+    }
     glUseProgram(m_Id);
+    s_Bound = m_Id;
+    s_Stats.programBinds++;
 }
 
 void Shader::Unbind(void) const
 {
+    if(s_Bound == 0)
+        return;
     glUseProgram(0);
+    s_Bound = 0;
 }
 
 #define SHADER_INFO_LOG_BUF_SIZE 512
@@ -288,6 +506,37 @@ void Shader::InitShader(const char *vertexPath, const char *fragmentPath)
     // delete shaders
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    ReflectUniforms();
+}
+
+#define SHADER_UNIFORM_NAME_SIZE 128
+void Shader::ReflectUniforms(void)
+{
+    // every active uniform outside a block, arrays answer to their bare name too
+    int count;
+    glGetProgramiv(m_Id, GL_ACTIVE_UNIFORMS, &count);
+    for(int i = 0; i < count; i++) {
+        char name[SHADER_UNIFORM_NAME_SIZE];
+        int length, size;
+        unsigned int type;
+        glGetActiveUniform(m_Id, i, SHADER_UNIFORM_NAME_SIZE, &length, &size, &type, name);
+        int location = glGetUniformLocation(m_Id, name);
+        if(location < 0)
+            continue;
+
+        m_UniformLocations[name] = location;
+        if(length > 3 && std::string(name + length - 3) == "[0]")
+            m_UniformLocations[std::string(name, length - 3)] = location;
+    }
+
+    m_Uniforms.model = GetUniform<Matrix4>("u_Model");
+    m_Uniforms.normalMat = GetUniform<Matrix4>("u_NormalMat");
+    m_Uniforms.instanced = GetUniform<int>("u_Instanced");
+    m_Uniforms.materialAmbient = GetUniform<Vector>("u_Material.ambient");
+    m_Uniforms.materialDiffuse = GetUniform<Vector>("u_Material.diffuse");
+    m_Uniforms.materialSpecular = GetUniform<Vector>("u_Material.specular");
+    m_Uniforms.materialShininess = GetUniform<int>("u_Material.shininess");
 }
 
 unsigned int Shader::CompileShader(const char *path, unsigned int type)
@@ -324,14 +573,77 @@ unsigned int Shader::CompileShader(const char *path, unsigned int type)
 
 int Shader::GetUniformLocation(const char *name) const
 {
-    return glGetUniformLocation(m_Id, name);
+    std::unordered_map<std::string, int>::const_iterator it = m_UniformLocations.find(name);
+    return it != m_UniformLocations.end() ? it->second : -1;
+}
+
+const ShaderUniforms& Shader::GetUniforms(void) const
+{
+    return m_Uniforms;
+}
+
+void Shader::BindUniformBlock(const char *name, unsigned int binding)
+{
+    unsigned int index = glGetUniformBlockIndex(m_Id, name);
+    if(index != GL_INVALID_INDEX)
+        glUniformBlockBinding(m_Id, index, binding);
+}
+
+void Shader::SetUniform(Uniform<int> uniform, int value)
+{
+    if(uniform.IsValid()) {
+        glUniform1i(uniform.location, value);
+        s_Stats.uniformUploads++;
+    }
+}
+
+void Shader::SetUniform(Uniform<float> uniform, float value)
+{
+    if(uniform.IsValid()) {
+        glUniform1f(uniform.location, value);
+        s_Stats.uniformUploads++;
+    }
+}
+
+void Shader::SetUniform(Uniform<Vector> uniform, const Vector& value)
+{
+    if(uniform.IsValid()) {
+        glUniform3fv(uniform.location, 1, &value.x);
+        s_Stats.uniformUploads++;
+    }
+}
+
+void Shader::SetUniform(Uniform<Color> uniform, const Color& value)
+{
+    if(uniform.IsValid()) {
+        glUniform4fv(uniform.location, 1, &value.r);
+        s_Stats.uniformUploads++;
+    }
+}
+
+void Shader::SetUniform(Uniform<Matrix3> uniform, const Matrix3& value)
+{
+    if(uniform.IsValid()) {
+        glUniformMatrix3fv(uniform.location, 1, true, value.GetData());
+        s_Stats.uniformUploads++;
+    }
+}
+
+void Shader::SetUniform(Uniform<Matrix4> uniform, const Matrix4& value)
+{
+    if(uniform.IsValid()) {
+        glUniformMatrix4fv(uniform.location, 1, true, value.GetData());
+        s_Stats.uniformUploads++;
+    }
 }
 
 void Shader::SetUniformInt(const char *name, int value)
 {
     int location = GetUniformLocation(name);
-    if(location >= 0)
+    if(location >= 0) {
         glUniform1i(location, value);
+        s_Stats.uniformUploads++;
+    }
     else
         std::cout << "SHADER::ERROR: uniform not found: " << name << std::endl;
 }
@@ -339,8 +651,10 @@ void Shader::SetUniformInt(const char *name, int value)
 void Shader::SetUniformFloat(const char *name, float value)
 {
     int location = GetUniformLocation(name);
-    if(location >= 0)
+    if(location >= 0) {
         glUniform1f(location, value);
+        s_Stats.uniformUploads++;
+    }
     else
         std::cout << "SHADER::ERROR: uniform not found: " << name << std::endl;
 }
@@ -348,8 +662,10 @@ void Shader::SetUniformFloat(const char *name, float value)
 void Shader::SetUniformVec3(const char *name, const Vector& value)
 {
     int location = GetUniformLocation(name);
-    if(location >= 0)
+    if(location >= 0) {
         glUniform3fv(location, 1, &value.x);
+        s_Stats.uniformUploads++;
+    }
     else
         std::cout << "SHADER::ERROR: uniform not found: " << name << std::endl;
 }
@@ -357,8 +673,10 @@ void Shader::SetUniformVec3(const char *name, const Vector& value)
 void Shader::SetUniformVec4(const char *name, const Vector& value)
 {
     int location = GetUniformLocation(name);
-    if(location >= 0)
+    if(location >= 0) {
         glUniform4fv(location, 1, &value.x);
+        s_Stats.uniformUploads++;
+    }
     else
         std::cout << "SHADER::ERROR: uniform not found: " << name << std::endl;
 }
@@ -366,8 +684,10 @@ void Shader::SetUniformVec4(const char *name, const Vector& value)
 void Shader::SetUniformMat3(const char *name, const Matrix3& value)
 {
     int location = GetUniformLocation(name);
-    if(location >= 0)
+    if(location >= 0) {
         glUniformMatrix3fv(location, 1, true, value.GetData());
+        s_Stats.uniformUploads++;
+    }
     else
         std::cout << "SHADER::ERROR: uniform not found: " << name << std::endl;
 }
@@ -377,6 +697,7 @@ void Shader::SetUniformMat4(const char *name, const Matrix4& value)
     int location = GetUniformLocation(name);
     if(location >= 0) {
         glUniformMatrix4fv(location, 1, true, value.GetData());
+        s_Stats.uniformUploads++;
     }
     else
         std::cout << "SHADER::ERROR: uniform not found: " << name << std::endl;
@@ -407,21 +728,27 @@ void Shader::SetFlags(unsigned char flags)
 
 void Shader::SetMaterial(const Material& material)
 {
-    //if(!(material == m_CurrentMaterial)) {
-        SetUniformVec3("u_Material.ambient", Vector(material.ambient.r, material.ambient.g, material.ambient.b));
-        SetUniformVec3("u_Material.diffuse", Vector(material.diffuse.r, material.diffuse.g, material.diffuse.b));
-        SetUniformVec3("u_Material.specular", Vector(material.specular.r, material.specular.g, material.specular.b));
-        SetUniformInt("u_Material.shininess", material.shininess);
-        m_CurrentMaterial = material;
-    //}
+    if(material == m_CurrentMaterial) {
+        s_Stats.uniformUploadsSkipped += 4;
+        return;
+    }
+
+    SetUniform(m_Uniforms.materialAmbient, Vector(material.ambient.r, material.ambient.g, material.ambient.b));
+    SetUniform(m_Uniforms.materialDiffuse, Vector(material.diffuse.r, material.diffuse.g, material.diffuse.b));
+    SetUniform(m_Uniforms.materialSpecular, Vector(material.specular.r, material.specular.g, material.specular.b));
+    SetUniform(m_Uniforms.materialShininess, material.shininess);
+    m_CurrentMaterial = material;
 }
 
-void Shader::SetDirLight(const DirLight& light)
+void Shader::SetInstanced(bool instanced)
 {
-    SetUniformVec3("u_Light.ambient", Vector(light.ambient.r, light.ambient.g, light.ambient.b));
-    SetUniformVec3("u_Light.diffuse", Vector(light.diffuse.r, light.diffuse.g, light.diffuse.b));
-    SetUniformVec3("u_Light.specular", Vector(light.specular.r, light.specular.g, light.specular.b));
-    SetUniformVec3("u_Light.direction", light.direction);
+    if(m_Instanced == (int)instanced) {
+        s_Stats.uniformUploadsSkipped++;
+        return;
+    }
+
+    SetUniform(m_Uniforms.instanced, (int)instanced);
+    m_Instanced = instanced;
 }
 
 #pragma endregion
\ No newline at end of file
@@ -3,11 +3,28 @@
 #include "Math.h"
 
 #include <vector>
+#include <string>
+#include <unordered_map>
 
 #pragma region primitive
 
+// gl calls issued and skipped as redundant since the last reset
+struct RenderStats
+{
+    int drawCalls = 0;
+    int programBinds = 0, programBindsSkipped = 0;
+    int vertexArrayBinds = 0, vertexArrayBindsSkipped = 0;
+    int uniformUploads = 0, uniformUploadsSkipped = 0;
+    int streamWrites = 0, streamStalls = 0;
+};
+
 class Primitive
 {
+public:
+    static RenderStats& GetStats(void);
+protected:
+    static RenderStats s_Stats;
+
 public:
     Primitive(void);
     virtual ~Primitive();
@@ -15,6 +32,7 @@ public:
     virtual void Bind(void) const = 0;
     virtual void Unbind(void) const = 0;
 
+    unsigned int GetId(void) const;
     int GetCount(void) const;
 
 protected:
@@ -41,14 +59,62 @@ public:
     virtual void Unbind(void) const override;
 
     void BufferData(float *data, int vertexCount, const std::vector<int>& layout);
+    void SetLayout(const std::vector<int>& layout, int firstAttribute = 0, int divisor = 0, int offset = 0) const;
+};
+
+#define STREAM_BUFFER_SEGMENTS 3
+
+// per-frame data written round robin into segments of one buffer, each fenced once the next write starts
+// a write only waits when the gpu is still reading the segment it wrote three frames ago
+// meant for one write per frame, with the draws reading it issued before the next write
+class StreamBuffer : public VertexBuffer
+{
+public:
+    StreamBuffer(void);
+    virtual ~StreamBuffer();
+
+    // copies the vertices into the next segment and returns its byte offset in the buffer
+    int Write(const float *data, int vertexCount, int stride);
+
+    int GetStallCount(void) const;
+
+private:
+    void Allocate(int segmentSize);
+    void WaitSegment(int segment);
+    void DeleteFences(void);
+
+private:
+    void *m_Fences[STREAM_BUFFER_SEGMENTS] = {};
+    int m_SegmentSize = 0;
+    int m_Segment = 0;
+    bool m_Written = false;
+    int m_StallCount = 0;
+};
+
+// a std140 block shared by every program that binds the same index
+class UniformBuffer : public Primitive
+{
+public:
+    UniformBuffer(void);
+    virtual ~UniformBuffer();
+
+    virtual void Bind(void) const override;
+    virtual void Unbind(void) const override;
+
+    void Init(int size, unsigned int binding);
+    void SetData(const void *data, int size, int offset = 0);
 };
 
 #pragma endregion
 
 #pragma region vertex_array
 
+// remembers the bound array so binding it again costs no gl call
 class VertexArray : public Primitive
 {
+private:
+    static unsigned int s_Bound;
+
 public:
     VertexArray(void);
     ~VertexArray();
@@ -76,14 +142,26 @@ public:
     void InitData(const char *path, const std::vector<int>& layout, unsigned int mode, Shader *shader);
     void InitData(float *vertices, int vertexCount, const std::vector<int>& layout, unsigned int mode, Shader *shader);
 
+    // per-instance attributes follow the vertex ones, in a second vertex array so plain draws never read them
+    void InitInstances(const std::vector<int>& layout);
+    void SetInstances(const float *instances, int instanceCount);
+    void BindInstanced(void) const;
+    unsigned int GetVertexArrayId(bool instanced = false) const;
+
     unsigned int GetMode(void) const;
     Shader *GetShader(void) const;
     int GetVertexCount(void) const;
+    int GetInstanceCount(void) const;
     void SetShader(Shader *shader);
 
 private:
     VertexBuffer m_VertexBuffer;
     VertexArray m_VertexArray;
+    std::vector<int> m_Layout;
+    StreamBuffer m_InstanceBuffer;
+    VertexArray m_InstanceArray;
+    std::vector<int> m_InstanceLayout;
+    int m_InstanceStride = 0;
     unsigned int m_Mode;
     Shader *m_Shader;
 };
@@ -132,11 +210,36 @@ enum ShaderFlag
 {
     Model               = BIT(0),
     NormalMatrix        = BIT(1),
-    NoTranslateView     = BIT(2)
+    Instanced           = BIT(2)
+};
+
+// a location resolved once at link time, the type picks the glUniform call
+template<typename T>
+struct Uniform
+{
+    int location = -1;
+
+    bool IsValid(void) const { return location >= 0; }
 };
 
+// uniforms set on every draw, resolved when the program links
+struct ShaderUniforms
+{
+    Uniform<Matrix4> model;
+    Uniform<Matrix4> normalMat;
+    Uniform<int> instanced;
+    Uniform<Vector> materialAmbient;
+    Uniform<Vector> materialDiffuse;
+    Uniform<Vector> materialSpecular;
+    Uniform<int> materialShininess;
+};
+
+// remembers the bound program so binding it again costs no gl call
 class Shader : public Primitive
 {
+private:
+    static unsigned int s_Bound;
+
 public:
     Shader(unsigned char flags = 0);
     ~Shader();
@@ -147,6 +250,18 @@ public:
     void InitShader(const char *vertexPath, const char *fragmentPath);
 
     int GetUniformLocation(const char *name) const;
+    template<typename T>
+    Uniform<T> GetUniform(const char *name) const;
+    const ShaderUniforms& GetUniforms(void) const;
+    void BindUniformBlock(const char *name, unsigned int binding);
+
+    void SetUniform(Uniform<int> uniform, int value);
+    void SetUniform(Uniform<float> uniform, float value);
+    void SetUniform(Uniform<Vector> uniform, const Vector& value);
+    void SetUniform(Uniform<Color> uniform, const Color& value);
+    void SetUniform(Uniform<Matrix3> uniform, const Matrix3& value);
+    void SetUniform(Uniform<Matrix4> uniform, const Matrix4& value);
+
     void SetUniformInt(const char *name, int value);
     void SetUniformFloat(const char *name, float value);
     void SetUniformVec3(const char *name, const Vector& value);
@@ -159,13 +274,27 @@ public:
     unsigned char GetFlags(void) const;
     void SetFlags(unsigned char flags);
 
+    // both skip the upload when the program already holds the value
     void SetMaterial(const Material& material);
-    void SetDirLight(const DirLight& light);
+    void SetInstanced(bool instanced);
 
 private:
     unsigned int CompileShader(const char *path, unsigned int type);
+    void ReflectUniforms(void);
+
     Material m_CurrentMaterial = { Color(), Color(), Color(), 0 };
+    int m_Instanced = -1;
     unsigned char m_Flags = 0;
+    std::unordered_map<std::string, int> m_UniformLocations;
+    ShaderUniforms m_Uniforms;
 };
 
+template<typename T>
+Uniform<T> Shader::GetUniform(const char *name) const
+{
+    Uniform<T> uniform;
+    uniform.location = GetUniformLocation(name);
+    return uniform;
+}
+
 #pragma endregion
\ No newline at end of file
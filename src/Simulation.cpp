@@ -59,7 +59,7 @@ void FlyerCamera::UpdateFlyer(void)
 
     }
     m_PrevMouseHold = mouseHold;
-    Vector forward = Matrix4::RotateY(m_Yaw) * Matrix4::RotateX(m_Pitch) * Vector(0.0f, 0.0f, -1.0f);
+    Vector forward = AffineTransform::RotateY(m_Yaw) * AffineTransform::RotateX(m_Pitch) * Vector(0.0f, 0.0f, -1.0f);
 
     // update position
     Vector right = Vector::Cross(forward, m_Up);
@@ -77,6 +77,7 @@ void FlyerCamera::UpdateFlyer(void)
         m_Position = m_Position - CAM_MOVE_SPEED * m_Up;
 
     m_View = Matrix4::LookAt(m_Position, m_Position + forward, m_Up);
+    m_Eye = m_Position;
 }
 
 void FlyerCamera::UpdateAlphaTrack(void)
@@ -85,11 +86,12 @@ void FlyerCamera::UpdateAlphaTrack(void)
     float pitch = Simulation::GetInstance()->GetAlphaBoid()->GetPitch();
     float yaw = Simulation::GetInstance()->GetAlphaBoid()->GetYaw();
 
-    Matrix4 orient = Matrix4::RotateY(yaw) * Matrix4::RotateX(pitch);
+    AffineTransform orient = AffineTransform::RotateY(yaw) * AffineTransform::RotateX(pitch);
     Point position = (orient * CAM_TRACK_POS_OFFSET) + alphaPosition;
     Point focus = (orient * CAM_TRACK_FOCUS_OFFSET) + alphaPosition;
     
     m_View = Matrix4::LookAt(position, focus, Vector(0.0f, 1.0f, 0.0f));
+    m_Eye = position;
 }
 
 void FlyerCamera::OnResize(int width, int height)
@@ -100,6 +102,12 @@ void FlyerCamera::OnResize(int width, int height)
 void FlyerCamera::SetPosition(const Point& position)
 {
     m_Position = position;
+    m_Eye = position;
+}
+
+Point FlyerCamera::GetPosition(void) const
+{
+    return m_Eye;
 }
 
 void FlyerCamera::SetMode(FlyerMode mode)
@@ -112,20 +120,10 @@ void FlyerCamera::SetMode(FlyerMode mode)
 #pragma region boid
 
 Mesh Boid::s_Mesh;
+std::vector<float> Boid::s_Instances;
 
-float Boid::s_MaxSpeed = 0.8f;
-float Boid::s_MaxForce = 0.1f;
-float Boid::s_ArrivalDistance = 5.0f;
-float Boid::s_SeparateDistance = 2.0f;
-float Boid::s_AlignDistance = 10.0f;
-float Boid::s_CohereDistance = 10.0f;
-float Boid::s_SeparateWeight = 1.0f;
-float Boid::s_AlignWeight = 1.0f;
-float Boid::s_CohereWeight = 1.0f;
-float Boid::s_AlphaAlignWeight = 0.2f;
-float Boid::s_AlphaCohereWeight = 0.2f;
-
-Boid::Boid(void) {}
+Boid::Boid(const FlockStore *store, int index, const Material *material)
+    : m_Store(store), m_Index(index), m_Material(material) {}
 
 Boid::~Boid() {}
 
@@ -133,201 +131,63 @@ void Boid::InitMesh(Shader *shader)
 {
     std::vector<int> layout = { 3, 3 };
     s_Mesh.InitData("assets/models/Boid.mesh", layout, GL_TRIANGLES, shader);
+
+    // position, forward, color and specular with the shininess in w per instance
+    std::vector<int> instanceLayout = { 3, 3, 3, 4 };
+    s_Mesh.InitInstances(instanceLayout);
 }
 
-void Boid::OnUpdate(void)
+void Boid::OnDraw(void) const
 {
-    Separate();
-    Align();
-    Cohere();
-
-    OnPhysicsUpdate();
-
-    Mirror();
+    Renderer::GetInstance()->Submit(s_Mesh, ComputeModel(GetPosition(), GetForward()), m_Material);
 }
 
-void Boid::OnDraw(void)
+void Boid::DrawInstances(const FlockStore *store, const Material *materials)
 {
-    // set material
-    s_Mesh.GetShader()->Bind();
-    s_Mesh.GetShader()->SetMaterial(*m_Material);
-    
-    // draw mesh
-    Renderer::GetInstance()->DrawMesh(s_Mesh, ComputeModel());
+    float interpolation = Application::GetInstance()->GetTickInterpolation();
+    int count = store->GetCount();
+    s_Instances.resize(count * 13);
+
+    float *instance = s_Instances.data();
+    for(int i = 0; i < count; i++, instance += 13) {
+        Point position = store->GetInterpolatedPosition(i, interpolation);
+        Vector forward = store->GetForward(i);
+        const Material& material = materials[store->species[i]];
+        instance[0] = position.x;               instance[1] = position.y;               instance[2] = position.z;
+        instance[3] = forward.x;                instance[4] = forward.y;                instance[5] = forward.z;
+        instance[6] = material.diffuse.r;       instance[7] = material.diffuse.g;       instance[8] = material.diffuse.b;
+        instance[9] = material.specular.r;      instance[10] = material.specular.g;     instance[11] = material.specular.b;
+        instance[12] = (float)material.shininess;
+    }
+    s_Mesh.SetInstances(s_Instances.data(), count);
+
+    // every species' material rides in the instances, the submitted one only keys the draw
+    Renderer::GetInstance()->SubmitInstanced(s_Mesh, &materials[0]);
 }
 
-Matrix4 Boid::ComputeModel(void) const
+AffineTransform Boid::ComputeModel(const Point& position, const Vector& direction)
 {
     float pitch, yaw;
-    Vector forward = m_Forward;
+    Vector forward = direction;
     pitch = RAD_TO_DEG(-asin(Tuple::Dot(forward, Vector(0.0f, -1.0f, 0.0f))));
     forward.y = 0.0f;
     forward.Normalize();
     yaw = RAD_TO_DEG(acos(Tuple::Dot(forward, Vector(0.0f, 0.0f, -1.0f))));
     if(Tuple::Dot(forward, Vector(1.0f, 0.0f, 0.0f)) > 0.0f)
         yaw = 360.0f - yaw;
-    Matrix4 model = Matrix4::Translate(m_Position.x, m_Position.y, m_Position.z) *
-                    Matrix4::RotateY(yaw) * Matrix4::RotateX(pitch);
+    AffineTransform model = AffineTransform::Translate(position.x, position.y, position.z) *
+                            AffineTransform::RotateY(yaw) * AffineTransform::RotateX(pitch);
     return model;
 }
 
 Point Boid::GetPosition(void) const
 {
-    return m_Position;
-}
-
-void Boid::SetPosition(const Point& position)
-{
-    m_Position = position;
-}
-
-void Boid::SetVelocity(const Vector& velocity)
-{
-    m_Velocity = velocity;
-}
-
-void Boid::SetMaterial(const Material *material)
-{
-    m_Material = material;
-}
-
-float Boid::GetMaxSpeed(void)
-{
-    return s_MaxSpeed;
-}
-
-void Boid::OnPhysicsUpdate(void)
-{
-    // update velocity
-    m_Velocity = m_Velocity + m_Acceleration;
-    if(m_Velocity.Magnitude() > s_MaxSpeed) {
-        m_Velocity.Normalize();
-        m_Velocity = s_MaxSpeed * m_Velocity;
-    }
-
-    // update forward
-    m_Forward = Vector::Normalize(m_Velocity);
-
-    // translate
-    m_Position = m_Position + m_Velocity;
-
-    // reset acceleration
-    m_Acceleration = Vector();
+    return m_Store->GetInterpolatedPosition(m_Index, Application::GetInstance()->GetTickInterpolation());
 }
 
-void Boid::AddForce(const Vector& force)
+Vector Boid::GetForward(void) const
 {
-    m_Acceleration = m_Acceleration + (1.0f / m_Mass) * force;
-}
-
-void Boid::Steer(const Vector& desired, float weight)
-{
-    Vector force = desired - m_Velocity;
-    if(force.Magnitude() > s_MaxForce) {
-        force.Normalize();
-        force = s_MaxForce * force * weight;
-    }
-    AddForce(force);
-}
-
-void Boid::Seek(const Point& target, float speed, float weight)
-{
-    Vector offset = target - m_Position;
-    Vector direction = Vector::Normalize(offset);
-    float distance = offset.Magnitude();
-
-    Vector desired = speed * direction;
-    if(distance < s_ArrivalDistance)
-        desired = (distance / s_ArrivalDistance) * desired;
-    
-    Steer(desired, weight);
-}
-
-void Boid::Separate(void)
-{
-    Boid *boids = Simulation::GetInstance()->GetBoids();
-
-    for(int i = 0; i < BOID_COUNT; i++) {
-        if(boids + i == this)
-            continue;
-
-        Vector offset = m_Position - boids[i].m_Position;
-        float distance = offset.Magnitude();
-
-        if(distance <= s_SeparateDistance) {
-            Vector desired = Vector::Normalize(offset);
-            desired = Clamp(s_SeparateDistance / distance, 0.0f, s_MaxSpeed) * desired;
-            Steer(desired, s_SeparateWeight);
-        }
-    }
-}
-
-void Boid::Align(void)
-{
-    Boid *boids = Simulation::GetInstance()->GetBoids();
-    
-    Vector averageForward;
-
-    for(int i = 0; i < BOID_COUNT; i++) {
-        if(boids + i == this)
-            continue;
-        
-        float distance = ((Vector)(m_Position - boids[i].m_Position)).Magnitude();
-
-        if(distance <= s_AlignDistance)
-            averageForward = averageForward + boids[i].m_Forward;
-    }
-
-    averageForward.Normalize();
-    averageForward = s_MaxSpeed * averageForward;
-    Steer(averageForward, s_AlignWeight);
-
-    // align alpha
-    Steer(Simulation::GetInstance()->GetAlphaBoid()->m_Forward * s_MaxSpeed, s_AlphaAlignWeight);
-}
-
-void Boid::Cohere(void)
-{
-    Boid *boids = Simulation::GetInstance()->GetBoids();
-
-    Vector averagePosition;
-    int count = 0;
-
-    for(int i = 0; i < BOID_COUNT; i++) {
-        if(boids + i == this)
-            continue;
-        
-        float distance = ((Vector)(m_Position - boids[i].m_Position)).Magnitude();
-
-        if(distance <= s_CohereDistance) {
-            averagePosition = averagePosition + boids[i].m_Position;
-            count++;
-        }
-    }
-
-    if(count > 1)
-        averagePosition = (1.0f / count) * averagePosition;
-
-    Seek(Point(averagePosition.x, averagePosition.y, averagePosition.z), s_MaxSpeed, s_CohereWeight);
-
-    // cohere alpha
-    Seek(Simulation::GetInstance()->GetAlphaBoid()->m_Position, s_MaxSpeed, s_AlphaCohereWeight);
-}
-
-void Boid::Mirror(void)
-{
-    float radius = BOUND_SIZE * 0.5f;
-    
-    Point mirrored = m_Position;
-
-    if(m_Position.x > radius)       mirrored.x = -2.0f * radius + m_Position.x;
-    else if(m_Position.x < -radius) mirrored.x =  2.0f * radius + m_Position.x;
-    if(m_Position.y > radius)       mirrored.y = -2.0f * radius + m_Position.y;
-    else if(m_Position.y < -radius) mirrored.y =  2.0f * radius + m_Position.y;
-    if(m_Position.z > radius)       mirrored.z = -2.0f * radius + m_Position.z;
-    else if(m_Position.z < -radius) mirrored.z =  2.0f * radius + m_Position.z;
-    
-    m_Position = mirrored;
+    return m_Store->GetForward(m_Index);
 }
 
 #pragma endregion
@@ -336,75 +196,84 @@ void Boid::Mirror(void)
 
 #define ALPHA_BOID_TURN_SPEED 3.0f;
 
-AlphaBoid::AlphaBoid(void) {}
+AlphaBoid::AlphaBoid(Flock *flock)
+    : m_Flock(flock) {}
 
 AlphaBoid::~AlphaBoid() {}
 
-void AlphaBoid::OnUpdate(void)
+void AlphaBoid::OnInput(void)
 {
+    AlphaState& alpha = m_Flock->GetAlpha();
+
     // update pitch and yaw
     if(Input::GetInstance()->GetKey(KEY_UP))
-        m_Pitch += ALPHA_BOID_TURN_SPEED;
+        alpha.pitch += ALPHA_BOID_TURN_SPEED;
     if(Input::GetInstance()->GetKey(KEY_DOWN))
-        m_Pitch -= ALPHA_BOID_TURN_SPEED;
+        alpha.pitch -= ALPHA_BOID_TURN_SPEED;
     if(Input::GetInstance()->GetKey(KEY_LEFT))
-        m_Yaw += ALPHA_BOID_TURN_SPEED;
+        alpha.yaw += ALPHA_BOID_TURN_SPEED;
     if(Input::GetInstance()->GetKey(KEY_RIGHT))
-        m_Yaw -= ALPHA_BOID_TURN_SPEED;
-    m_Pitch = Clamp(m_Pitch, -89.0f, 89.0f);
-
-    m_Forward = Matrix4::RotateY(m_Yaw) * Matrix4::RotateX(m_Pitch) * Vector(0.0f, 0.0f, -1.0f);
-    m_Velocity = m_Speed * m_Forward;
-
-    OnPhysicsUpdate();
-    
-    Mirror();
+        alpha.yaw -= ALPHA_BOID_TURN_SPEED;
+    alpha.pitch = Clamp(alpha.pitch, -89.0f, 89.0f);
 }
 
-void AlphaBoid::OnDraw(void)
+void AlphaBoid::OnDraw(void) const
 {
-    if(!m_IsHighlighted) {
-        Boid::OnDraw();
-        return;
-    }
+    Mesh& mesh = Boid::s_Mesh;
+    AffineTransform model = Boid::ComputeModel(GetPosition(), m_Flock->GetAlpha().forward);
 
-    // setup stencil to draw one
-    glEnable(GL_STENCIL_TEST);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
-    glStencilMask(0xFF);
+    if(m_IsHighlighted) {
+        // setup stencil to draw one
+        glEnable(GL_STENCIL_TEST);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+        glStencilFunc(GL_ALWAYS, 1, 0xFF);
+        glStencilMask(0xFF);
+    }
     
     // set material
-    s_Mesh.GetShader()->Bind();
-    s_Mesh.GetShader()->SetMaterial(*m_Material);
+    mesh.GetShader()->Bind();
+    mesh.GetShader()->SetMaterial(*m_Material);
     
     // draw mesh
-    Matrix4 model = ComputeModel();
-    Renderer::GetInstance()->DrawMesh(s_Mesh, model);
+    Renderer::GetInstance()->DrawMesh(mesh, model);
+
+    if(!m_IsHighlighted)
+        return;
 
     glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
     glStencilMask(0x00);
     
-    Shader *phongShader = s_Mesh.GetShader();
+    Shader *phongShader = mesh.GetShader();
     Shader *highlightShader = Simulation::GetInstance()->GetHighlightShader();
     
     highlightShader->Bind();
     highlightShader->SetUniformVec3("u_Color", { m_HighlightColor.r, m_HighlightColor.g, m_HighlightColor.b });
-    s_Mesh.SetShader(highlightShader);
-    Renderer::GetInstance()->DrawMesh(s_Mesh, model * Matrix4::Scale(1.3f, 1.3f, 1.3f));
-    s_Mesh.SetShader(phongShader);
+    mesh.SetShader(highlightShader);
+    Renderer::GetInstance()->DrawMesh(mesh, model * AffineTransform::Scale(1.3f, 1.3f, 1.3f));
+    mesh.SetShader(phongShader);
 
     glDisable(GL_STENCIL_TEST);
 }
 
+Point AlphaBoid::GetPosition(void) const
+{
+    const AlphaState& alpha = m_Flock->GetAlpha();
+    return Flock::Interpolate(alpha.previousPosition, alpha.position, Application::GetInstance()->GetTickInterpolation());
+}
+
 float AlphaBoid::GetPitch(void) const
 {
-    return m_Pitch;
+    return m_Flock->GetAlpha().pitch;
 }
 
 float AlphaBoid::GetYaw(void) const
 {
-    return m_Yaw;
+    return m_Flock->GetAlpha().yaw;
+}
+
+void AlphaBoid::SetMaterial(const Material *material)
+{
+    m_Material = material;
 }
 
 #pragma endregion
@@ -417,7 +286,8 @@ Simulation *Simulation::GetInstance(void)
     return s_Instance;
 }
 
-Simulation::Simulation(void)
+Simulation::Simulation(int boidCount)
+    : m_AlphaBoid(&m_Flock), m_BoidCount(Clamp(boidCount, 0, BOID_COUNT_MAX))
 {
     if(s_Instance == nullptr) {
         s_Instance = this;
@@ -437,11 +307,10 @@ void Simulation::OnInit(void)
     glFrontFace(GL_CCW);
 
     // init shaders
-    m_PhongShader.SetFlags(ShaderFlag::Model | ShaderFlag::NormalMatrix);
+    m_PhongShader.SetFlags(ShaderFlag::Model | ShaderFlag::NormalMatrix | ShaderFlag::Instanced);
     m_PhongShader.InitShader("assets/shaders/Phong_V.glsl", "assets/shaders/Phong_F.glsl");
     m_UnlitShader.SetFlags(ShaderFlag::Model);
     m_UnlitShader.InitShader("assets/shaders/Unlit_V.glsl", "assets/shaders/Unlit_F.glsl");
-    m_SkyboxShader.SetFlags(ShaderFlag::NoTranslateView);
     m_SkyboxShader.InitShader("assets/shaders/Skybox_V.glsl", "assets/shaders/Skybox_F.glsl");
     m_SkyboxShader.Bind();
     m_SkyboxShader.SetUniformInt("u_Skybox", 0);
@@ -457,8 +326,7 @@ void Simulation::OnInit(void)
     m_Renderer.SetCamera(&m_Camera);
     
     // init light
-    m_PhongShader.Bind();
-    m_PhongShader.SetDirLight({
+    m_Renderer.SetDirLight({
         { 0.05f, 0.05f, 0.15f },
         { 0.9f, 0.9f, 0.9f },
         { 1.0f, 1.0f, 1.0f },
@@ -467,26 +335,25 @@ void Simulation::OnInit(void)
     
     // init boid data
     Boid::InitMesh(&m_PhongShader);
-    m_BoidMaterial = Material({
-        { 0.9f, 0.3f, 0.1f },
-        { 0.9f, 0.3f, 0.1f },
-        { 1.0f, 1.0f, 1.0f },
-        50
-    });
+    const Color speciesColors[SPECIES_MAX] = {
+        { 0.9f, 0.3f, 0.1f }, { 0.1f, 0.5f, 0.9f }, { 0.2f, 0.8f, 0.3f }, { 0.9f, 0.8f, 0.1f },
+        { 0.7f, 0.2f, 0.9f }, { 0.1f, 0.8f, 0.8f }, { 0.9f, 0.2f, 0.5f }, { 0.6f, 0.6f, 0.6f },
+    };
+    for(int s = 0; s < SPECIES_MAX; s++) {
+        m_BoidMaterials[s] = Material({
+            speciesColors[s],
+            speciesColors[s],
+            { 1.0f, 1.0f, 1.0f },
+            50
+        });
+    }
     m_AlphaBoidMaterial = Material({
         { 1.0f, 1.0f, 1.0f },
         { 1.0f, 1.0f, 1.0f },
         { 1.0f, 1.0f, 1.0f },
         50
     });
-    for(int i = 0; i < BOID_COUNT; i++) {
-        m_Boids[i].SetMaterial(&m_BoidMaterial);
-        m_Boids[i].SetPosition(Vector(
-            Random(-BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f),
-            Random(-BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f),
-            Random(-BOUND_SIZE / 2.0f, BOUND_SIZE / 2.0f)));
-        m_Boids[i].SetVelocity(Boid::GetMaxSpeed() * RandomUnitSphere());
-    }
+    m_Flock.Init(m_BoidCount);
     m_AlphaBoid.SetMaterial(&m_AlphaBoidMaterial);
 
     // init bound data
@@ -506,32 +373,42 @@ void Simulation::OnInit(void)
     m_Skybox.Load(0, skyboxPaths);
 }
 
+void Simulation::OnFixedUpdate(void)
+{
+    m_AlphaBoid.OnInput();
+    m_Flock.SetViewer(m_Camera.GetPosition());
+    m_Flock.Step();
+}
+
 void Simulation::OnUpdate(void)
 {
-    for(int i = 0; i < BOID_COUNT; i++)
-        m_Boids[i].OnUpdate();
-    m_AlphaBoid.OnUpdate();
-    
     // update camera
     m_Camera.OnUpdate();
 }
 
 void Simulation::OnRender(void)
 {
-    // draw boids
-    m_AlphaBoid.OnDraw();
-    for(int i = 0; i < BOID_COUNT; i++)
-        m_Boids[i].OnDraw();
+    // queue boids
+    if(m_InstancedRendering) {
+        Boid::DrawInstances(&m_Flock.GetStore(), m_BoidMaterials);
+    } else {
+        for(int i = 0; i < m_Flock.GetStore().GetCount(); i++)
+            GetBoid(i).OnDraw();
+    }
 
-    // draw bounds
+    // queue bounds
     m_UnlitShader.Bind();
     m_UnlitShader.SetUniformVec3("u_Color", Vector(1.0f, 1.0f, 1.0f));
-    m_Renderer.DrawMesh(m_BoundMesh, Matrix4::Scale(BOUND_SIZE, BOUND_SIZE, BOUND_SIZE));
-    
+    m_Renderer.Submit(m_BoundMesh, AffineTransform::Scale(BOUND_SIZE, BOUND_SIZE, BOUND_SIZE));
+    m_Renderer.Flush();
+
+    // the alpha's stencil outline and the skybox depend on draw order, so they go straight through
+    m_AlphaBoid.OnDraw();
+
     // draw skybox
     glDepthFunc(GL_LEQUAL);
     m_Skybox.Bind(0);
-    m_Renderer.DrawMesh(m_SkyboxMesh, Matrix4::Identity());
+    m_Renderer.DrawMesh(m_SkyboxMesh, AffineTransform::Identity());
     glDepthFunc(GL_LESS);
 }
 
@@ -539,6 +416,31 @@ void Simulation::OnGUIRender(void)
 {
     ImGui::Begin("System");
     ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::Text("%d ticks this frame", m_TicksThisFrame);
+    ImGui::Checkbox("VSync", &m_VSync);
+    ImGui::SliderFloat("Tick Rate", &m_TickRate, 5.0f, 240.0f, "%.0f Hz");
+    ImGui::SliderInt("Max Substeps", &m_MaxSubsteps, 1, 16);
+
+    if(ImGui::CollapsingHeader("Profiler", ImGuiTreeNodeFlags_DefaultOpen)) {
+        const RenderStats& render = m_Renderer.GetFrameStats();
+        ImGui::Checkbox("Instanced Rendering", &m_InstancedRendering);
+        ImGui::Text("Draw calls: %d", render.drawCalls);
+        ImGui::Text("Program binds: %d, %d skipped", render.programBinds, render.programBindsSkipped);
+        ImGui::Text("Vertex array binds: %d, %d skipped", render.vertexArrayBinds, render.vertexArrayBindsSkipped);
+        ImGui::Text("Uniform uploads: %d, %d skipped", render.uniformUploads, render.uniformUploadsSkipped);
+        ImGui::Text("Stream writes: %d, %d stalls (%d total)", render.streamWrites, render.streamStalls, m_Renderer.GetStreamStallCount());
+        const NeighborListStats& lists = m_Flock.GetListStats();
+        if(!m_Flock.GetOptions().neighborLists) {
+            ImGui::Text("Neighbor lists: off");
+        } else if(lists.overflowed) {
+            ImGui::Text("Neighbor lists: too many pairs, searching every step");
+        } else {
+            ImGui::Text("Neighbor lists: rebuilt %d of %d steps (%.0f%%)", lists.rebuilds, lists.steps, 100.0f * lists.rebuilds / std::max(lists.steps, 1));
+            ImGui::Text("List build %.3f ms, check %.3f ms", lists.buildMs, lists.checkMs);
+            ImGui::Text("Step %.3f ms rebuilding, %.3f ms reusing", lists.rebuildStepMs, lists.reuseStepMs);
+            ImGui::Text("Saved %.1f ms vs rebuilding every step", lists.savedMs);
+        }
+    }
     ImGui::End();
     
     ImGui::Begin("Flocking");
@@ -551,29 +453,169 @@ void Simulation::OnGUIRender(void)
     }
     ImGui::Checkbox("Alpha Highlight", &m_AlphaBoid.m_IsHighlighted);
 
+    // limits, distances, weights and color below edit the selected species
+    m_EditSpecies = std::min(m_EditSpecies, m_Flock.GetSpeciesCount() - 1);
+    FlockParams& params = m_Flock.GetParams(m_EditSpecies);
+    FlockOptions& options = m_Flock.GetOptions();
+
+    if(ImGui::CollapsingHeader("Population", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if(ImGui::InputInt("Boid Count", &m_BoidCount, 100, 10000, ImGuiInputTextFlags_EnterReturnsTrue)) {
+            m_BoidCount = Clamp(m_BoidCount, 0, BOID_COUNT_MAX);
+            m_Flock.SetCount(m_BoidCount);
+        }
+        if(ImGui::Button("Spawn 1000"))
+            m_Flock.Spawn(1000);
+        ImGui::SameLine();
+        if(ImGui::Button("Despawn 1000"))
+            m_Flock.Despawn(1000);
+        m_BoidCount = m_Flock.GetStore().GetCount();
+        ImGui::Text("Pool: %d / %d", m_Flock.GetStore().GetCount(), m_Flock.GetStore().GetCapacity());
+    }
+
+    if(ImGui::CollapsingHeader("Species", ImGuiTreeNodeFlags_DefaultOpen)) {
+        int speciesCount = m_Flock.GetSpeciesCount();
+        if(ImGui::SliderInt("Species", &speciesCount, 1, SPECIES_MAX))
+            m_Flock.SetSpeciesCount(speciesCount);
+        if(m_Flock.GetSpeciesCount() > 1) {
+            ImGui::SliderInt("Edit Species", &m_EditSpecies, 0, m_Flock.GetSpeciesCount() - 1);
+
+            // rows are the steering species, columns the neighbors they react to
+            const char *terms[] = { "Separate", "Align", "Cohere" };
+            ImGui::Combo("Interaction", &m_InteractionTerm, terms, 3);
+            SpeciesMatrix& interaction = m_Flock.GetInteraction();
+            float (*matrix)[SPECIES_MAX] = interaction.separate;
+            if(m_InteractionTerm == 1)
+                matrix = interaction.align;
+            else if(m_InteractionTerm == 2)
+                matrix = interaction.cohere;
+            for(int row = 0; row < m_Flock.GetSpeciesCount(); row++) {
+                for(int column = 0; column < m_Flock.GetSpeciesCount(); column++) {
+                    if(column > 0)
+                        ImGui::SameLine();
+                    ImGui::PushID(row * SPECIES_MAX + column);
+                    ImGui::SetNextItemWidth(40.0f);
+                    ImGui::DragFloat("##factor", &matrix[row][column], 0.01f, 0.0f, 2.0f, "%.2f");
+                    ImGui::PopID();
+                }
+            }
+
+            int start, count;
+            if(m_Flock.GetSpeciesRange(m_EditSpecies, start, count))
+                ImGui::Text("Species %d: %d boids from %d", m_EditSpecies, count, start);
+        }
+    }
+
+    if(ImGui::CollapsingHeader("Neighbor Search", ImGuiTreeNodeFlags_DefaultOpen)) {
+        const char *searches[] = { "Brute Force", "Grid", "Octree" };
+        int search = (int)options.neighborSearch;
+        if(ImGui::Combo("Search", &search, searches, 3))
+            options.neighborSearch = (NeighborSearch)search;
+        ImGui::Checkbox("Periodic Bound", &options.periodic);
+        if(options.neighborSearch == NeighborSearch::Grid) {
+            ImGui::Checkbox("Incremental Grid", &options.incrementalGrid);
+            ImGui::Checkbox("Cell Aggregates", &options.cellAggregates);
+        }
+        ImGui::Checkbox("Topological (k Nearest)", &options.topological);
+        if(options.topological)
+            ImGui::SliderInt("Neighbors (k)", &options.topologicalCount, 1, KNN_MAX);
+        ImGui::Checkbox("Neighbor Lists", &options.neighborLists);
+        if(options.neighborLists)
+        {
+            ImGui::SliderInt("List Reuse Steps", &options.listReuseSteps, 1, 8);
+            ImGui::SliderFloat("List Skin", &options.listSkin, 0.0f, 20.0f, options.listSkin > 0.0f ? "%.2f" : "auto");
+        }
+        ImGui::Checkbox("Half Shell Separation", &options.halfShellSeparation);
+        ImGui::SliderInt("Steering Slices", &options.steeringSlices, 1, 8, options.steeringSlices > 1 ? "%d steps" : "every step");
+        ImGui::Checkbox("Fused Steering", &options.fusedSteering);
+        if(options.fusedSteering) {
+            const char *simdLevels[] = { GetSimdLevelName(SimdLevel::Scalar), GetSimdLevelName(SimdLevel::SSE41), GetSimdLevelName(SimdLevel::AVX2) };
+            int simdLevel = (int)options.simdLevel;
+            if(ImGui::Combo("Kernel", &simdLevel, simdLevels, (int)m_Flock.GetMaxSimdLevel() + 1))
+                options.simdLevel = (SimdLevel)simdLevel;
+        }
+        if(options.topological) {
+            ImGui::Text("KD tree: %d nodes", m_Flock.GetKdTree().GetNodeCount());
+        } else if(options.neighborSearch == NeighborSearch::Grid) {
+            const SpatialGrid& grid = m_Flock.GetGrid();
+            ImGui::Text("Grid: %d^3 cells", grid.GetResolution());
+            if(options.incrementalGrid)
+                ImGui::Text("Moved: %d boids%s", grid.GetMovedCount(), grid.WasRebuilt() ? ", rebuilt" : "");
+        } else if(options.neighborSearch == NeighborSearch::Octree) {
+            const SpatialOctree& octree = m_Flock.GetOctree();
+            ImGui::Text("Octree: %d nodes, %d leaves", octree.GetNodeCount(), octree.GetLeafCount());
+            ImGui::Text("Moved: %d boids", octree.GetMovedCount());
+        } else {
+            ImGui::Text("Brute force: %d checks/boid", m_Flock.GetStore().GetCount());
+        }
+        ImGui::Text("Index: %.2f ms", m_Flock.GetStats().indexMs);
+        ImGui::Text("Neighbor candidates: %lld", m_Flock.GetStats().neighborCandidates);
+        if(options.halfShellSeparation && (!options.doubleBuffered || options.fusedSteering))
+            ImGui::Text("Half shell needs double buffered, unfused steps");
+        else if(options.halfShellSeparation)
+            ImGui::Text("Separation: %lld tests, %lld pairs", m_Flock.GetStats().separationTests, m_Flock.GetStats().separationPairs);
+    }
+
+    if(ImGui::CollapsingHeader("Level of Detail", ImGuiTreeNodeFlags_DefaultOpen)) {
+        // far clusters collapse into super boids, the gap up to the near distance keeps them from flickering
+        const LodStats& lod = m_Flock.GetLodStats();
+        ImGui::Checkbox("Super Boids", &options.lod);
+        if(options.lod) {
+            ImGui::SliderFloat("Expand Within", &options.lodNearDistance, 0.0f, 150.0f);
+            ImGui::SliderFloat("Collapse Beyond", &options.lodFarDistance, options.lodNearDistance, 150.0f);
+            ImGui::SliderFloat("Cluster Size", &options.lodClusterSize, 1.0f, 20.0f);
+            ImGui::SliderInt("Recluster Interval", &options.lodReclusterInterval, 0, 120, options.lodReclusterInterval > 0 ? "%d steps" : "never");
+            options.lodFarDistance = std::max(options.lodFarDistance, options.lodNearDistance);
+        }
+        ImGui::Text("Super boids: %d, %d members", lod.superBoids, lod.members);
+        ImGui::Text("Steered: %d of %d", m_Flock.GetStore().GetCount() - lod.members + lod.superBoids, m_Flock.GetStore().GetCount());
+    }
+
+    if(ImGui::CollapsingHeader("Memory Order", ImGuiTreeNodeFlags_DefaultOpen)) {
+        // set the interval to 0 to compare against the unsorted store
+        const FlockStats& stats = m_Flock.GetStats();
+        ImGui::SliderInt("Sort Interval", &options.sortInterval, 0, 120, options.sortInterval > 0 ? "%d steps" : "never");
+        ImGui::Text("Sorts: %d", m_Flock.GetSortCount());
+        ImGui::Text("Neighbor lines: %.2f/boid", (float)stats.neighborLines / std::max(m_Flock.GetStore().GetCount(), 1));
+        if(stats.cacheMisses >= 0)
+            ImGui::Text("Cache misses: %.2f/boid", (float)stats.cacheMisses / std::max(m_Flock.GetStore().GetCount(), 1));
+        else
+            ImGui::Text("Cache misses: no hardware counter");
+    }
+
+    if(ImGui::CollapsingHeader("Threading", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGui::Checkbox("Double Buffered", &options.doubleBuffered);
+        if(options.doubleBuffered)
+            ImGui::SliderInt("Threads", &options.threadCount, 1, m_Flock.GetMaxThreadCount());
+        else
+            ImGui::Text("In place update runs on 1 thread");
+    }
+
     if(ImGui::CollapsingHeader("Limits", ImGuiTreeNodeFlags_DefaultOpen)) {
-        ImGui::SliderFloat("Max Speed", &Boid::s_MaxSpeed, 0.1f, 2.0f);
-        ImGui::SliderFloat("Max Force", &Boid::s_MaxForce, 0.01f, 0.2f);
+        ImGui::SliderFloat("Max Speed", &params.maxSpeed, 0.1f, 2.0f);
+        ImGui::SliderFloat("Max Force", &params.maxForce, 0.01f, 0.2f);
     }
 
     if(ImGui::CollapsingHeader("Distances", ImGuiTreeNodeFlags_DefaultOpen)) {
-        ImGui::SliderFloat("Arrival Distance",  &Boid::s_ArrivalDistance, 1.0f, 20.0f);
-        ImGui::SliderFloat("Separate Distance", &Boid::s_SeparateDistance, 1.0f, 20.0f);
-        ImGui::SliderFloat("Align Distance",    &Boid::s_AlignDistance, 1.0f, 20.0f);
-        ImGui::SliderFloat("Cohere Distance",   &Boid::s_CohereDistance, 1.0f, 20.0f);
+        ImGui::SliderFloat("Arrival Distance",  &params.arrivalDistance, 1.0f, 20.0f);
+        ImGui::SliderFloat("Separate Distance", &params.separateDistance, 1.0f, 20.0f);
+        ImGui::SliderFloat("Align Distance",    &params.alignDistance, 1.0f, 20.0f);
+        ImGui::SliderFloat("Cohere Distance",   &params.cohereDistance, 1.0f, 20.0f);
     }
     
     if(ImGui::CollapsingHeader("Weights", ImGuiTreeNodeFlags_DefaultOpen)) {
-        ImGui::SliderFloat("Separate Weight",   &Boid::s_SeparateWeight, 0.0f, 2.0f);
-        ImGui::SliderFloat("Align Weight",      &Boid::s_AlignWeight, 0.0f, 2.0f);
-        ImGui::SliderFloat("Cohere Weight",     &Boid::s_CohereWeight, 0.0f, 2.0f);
-        ImGui::SliderFloat("Alpha Align Weight", &Boid::s_AlphaAlignWeight, 0.0f, 2.0f);
-        ImGui::SliderFloat("Alpha Cohere Weight", &Boid::s_AlphaCohereWeight, 0.0f, 2.0f);
+        ImGui::SliderFloat("Separate Weight",   &params.separateWeight, 0.0f, 2.0f);
+        ImGui::SliderFloat("Align Weight",      &params.alignWeight, 0.0f, 2.0f);
+        ImGui::SliderFloat("Cohere Weight",     &params.cohereWeight, 0.0f, 2.0f);
+        ImGui::SliderFloat("Alpha Align Weight", &params.alphaAlignWeight, 0.0f, 2.0f);
+        ImGui::SliderFloat("Alpha Cohere Weight", &params.alphaCohereWeight, 0.0f, 2.0f);
     }
 
     if(ImGui::CollapsingHeader("Colors")) {
-        if(ImGui::ColorEdit3("Boid Color", &m_BoidMaterial.diffuse.r))
-            m_BoidMaterial.ambient = m_BoidMaterial.diffuse;
+        Material& material = m_BoidMaterials[m_EditSpecies];
+        if(ImGui::ColorEdit3("Boid Color", &material.diffuse.r))
+            material.ambient = material.diffuse;
+        ImGui::ColorEdit3("Boid Specular", &material.specular.r);
+        ImGui::SliderInt("Boid Shininess", &material.shininess, 1, 256);
         if(ImGui::ColorEdit3("Alpha Boid Color", &m_AlphaBoidMaterial.diffuse.r))
             m_AlphaBoidMaterial.ambient = m_AlphaBoidMaterial.diffuse;
         ImGui::ColorEdit3("Alpha Highlight Color", &m_AlphaBoid.m_HighlightColor.r);
@@ -587,9 +629,9 @@ void Simulation::OnResize(int width, int height)
     m_Camera.OnResize(width, height);
 }
 
-Boid *Simulation::GetBoids(void)
+Boid Simulation::GetBoid(int index) const
 {
-    return m_Boids;
+    return Boid(&m_Flock.GetStore(), index, &m_BoidMaterials[m_Flock.GetStore().species[index]]);
 }
 
 AlphaBoid *Simulation::GetAlphaBoid(void)
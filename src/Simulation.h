@@ -1,8 +1,10 @@
 #pragma once
 
 #include "Application.h"
+#include "Flock.h"
 
 #include <utility>
+#include <vector>
 
 #pragma region flyer_camera
 
@@ -24,12 +26,16 @@ public:
     void SetPosition(const Point& position);
     void SetMode(FlyerMode mode);
 
+    // eye of the last update, in alpha track mode it trails the alpha
+    Point GetPosition(void) const;
+
 private:
     void UpdateFlyer(void);
     void UpdateAlphaTrack(void);
 
 private:
     Point m_Position = Point(0.0f, 0.0f, 3.0f);
+    Point m_Eye = Point(0.0f, 0.0f, 3.0f);
     float m_Pitch = 0.0f;
     float m_Yaw = 0.0f;
     Vector m_Up = Vector(0.0f, 1.0f, 0.0f);
@@ -48,75 +54,59 @@ private:
 
 #pragma region boid
 
-#define BOUND_SIZE 50.0f
-#define BOID_COUNT 100
-
+// thin view of one boid in the flock store, used for drawing and the gui
 class Boid
 {
 public:
-    Boid(void);
+    Boid(const FlockStore *store, int index, const Material *material);
     ~Boid();
 
     static void InitMesh(Shader *shader); 
-    virtual void OnUpdate(void);
-    virtual void OnDraw(void);
+    void OnDraw(void) const;
+
+    // uploads every boid in the store as one instance and draws them in a single call
+    static void DrawInstances(const FlockStore *store, const Material *materials);
 
     Point GetPosition(void) const;
-    void SetPosition(const Point& position);
-    void SetVelocity(const Vector& velocity);
-    void SetMaterial(const Material *material);
-    static float GetMaxSpeed(void);
+    Vector GetForward(void) const;
 
 protected:
-    void OnPhysicsUpdate(void);
-    void AddForce(const Vector& force);
-    void Steer(const Vector& desired, float weight);
-    void Seek(const Point& target, float speed, float weight);
-    void Separate(void);
-    void Align(void);
-    void Cohere(void);
-    void Mirror(void);
-
-    Matrix4 ComputeModel(void) const;
+    static AffineTransform ComputeModel(const Point& position, const Vector& forward);
 
 protected:
-    Point m_Position;
-    Vector m_Velocity;
-    Vector m_Acceleration;
-    Vector m_Forward = Vector(0.0f, 0.0f, -1.0f);
-    float m_Mass = 20.0f;
-
-    static Mesh s_Mesh;
+    const FlockStore *m_Store;
+    int m_Index;
     const Material *m_Material;
 
-    static float s_MaxSpeed, s_MaxForce;
-    static float s_ArrivalDistance, s_SeparateDistance, s_AlignDistance, s_CohereDistance;
-    static float s_SeparateWeight, s_AlignWeight, s_CohereWeight, s_AlphaAlignWeight, s_AlphaCohereWeight;
+    static Mesh s_Mesh;
+    static std::vector<float> s_Instances;
 
 private:
-    friend class Simulation;
+    friend class AlphaBoid;
 };
 
 #pragma endregion
 
 #pragma region alpha_boid
 
-class AlphaBoid : public Boid
+// thin view of the flock's alpha state, steered by the arrow keys
+class AlphaBoid
 {
 public:
-    AlphaBoid(void);
+    AlphaBoid(Flock *flock);
     ~AlphaBoid();
 
-    virtual void OnUpdate(void) override;
-    virtual void OnDraw(void) override;
+    void OnInput(void);
+    void OnDraw(void) const;
 
+    Point GetPosition(void) const;
     float GetPitch(void) const;
     float GetYaw(void) const;
+    void SetMaterial(const Material *material);
 
 private:
-    float m_Pitch = 0.0f;
-    float m_Yaw = 0.0f;
-    float m_Speed = 0.4f;
+    Flock *m_Flock;
+    const Material *m_Material = nullptr;
 
     Color m_HighlightColor = Color(1.0f, 0.0f, 0.0f);
     bool m_IsHighlighted = true;
@@ -136,15 +126,16 @@ public:
 private:
     static Simulation *s_Instance;
 public:
-    Simulation(void);
+    Simulation(int boidCount = BOID_COUNT_DEFAULT);
     virtual ~Simulation();
 
-    Boid *GetBoids(void);
+    Boid GetBoid(int index) const;
     AlphaBoid *GetAlphaBoid(void);
     Shader *GetHighlightShader(void);
 
 protected:
     virtual void OnInit(void) override;
+    virtual void OnFixedUpdate(void) override;
     virtual void OnUpdate(void) override;
     virtual void OnRender(void) override;
     virtual void OnGUIRender(void) override;
@@ -160,10 +151,11 @@ private:
     FlyerCamera m_Camera;
 
     // boids
-    Material m_BoidMaterial;
+    Material m_BoidMaterials[SPECIES_MAX];
     Material m_AlphaBoidMaterial;
-    Boid m_Boids[BOID_COUNT];
+    Flock m_Flock;
     AlphaBoid m_AlphaBoid;
+    int m_BoidCount;
     
     // bound and skybox
     Mesh m_BoundMesh;
@@ -171,6 +163,11 @@ private:
     CubeMap m_Skybox;
 
     bool m_TrackingAlpha = false;
+    bool m_InstancedRendering = true;
+
+    // species shown by the parameter sliders and the interaction term the matrix edits
+    int m_EditSpecies = 0;
+    int m_InteractionTerm = 0;
 };
 
 #pragma endregion
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+// chunks are rounded to whole cache lines of float lanes so neighboring chunks never share a line
+#define THREAD_POOL_CHUNK_ALIGN 16
+#define THREAD_POOL_MIN_CHUNK 64
+#define THREAD_POOL_CHUNKS_PER_THREAD 8
+
+int ThreadPool::GetHardwareThreadCount(void)
+{
+    return std::max((int)std::thread::hardware_concurrency(), 1);
+}
+
+ThreadPool::ThreadPool(void)
+    : m_NextIndex(0) {}
+
+ThreadPool::~ThreadPool()
+{
+    Shutdown();
+}
+
+void ThreadPool::Init(int threadCount)
+{
+    Shutdown();
+
+    m_Quit = false;
+    for(int i = 1; i < threadCount; i++)
+        m_Workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+}
+
+void ThreadPool::Shutdown(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_WakeCondition.notify_all();
+
+    for(std::thread& worker : m_Workers)
+        worker.join();
+    m_Workers.clear();
+}
+
+void ThreadPool::ParallelFor(int count, int threadCount, const Job& job)
+{
+    threadCount = std::min(std::max(threadCount, 1), GetThreadCount());
+    if(threadCount == 1 || count <= THREAD_POOL_MIN_CHUNK) {
+        job(0, count, 0);
+        return;
+    }
+
+    // dispatch
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        int chunkSize = std::max(count / (threadCount * THREAD_POOL_CHUNKS_PER_THREAD), THREAD_POOL_MIN_CHUNK);
+        m_ChunkSize = (chunkSize + THREAD_POOL_CHUNK_ALIGN - 1) / THREAD_POOL_CHUNK_ALIGN * THREAD_POOL_CHUNK_ALIGN;
+        m_Job = &job;
+        m_JobCount = count;
+        m_ActiveThreads = threadCount;
+        m_NextIndex = 0;
+        m_Pending = (int)m_Workers.size();
+        m_Generation++;
+    }
+    m_WakeCondition.notify_all();
+
+    RunChunks(0);
+
+    // wait for every worker to acknowledge, idle ones included, before the job goes out of scope
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_DoneCondition.wait(lock, [this] { return m_Pending == 0; });
+    m_Job = nullptr;
+}
+
+int ThreadPool::GetThreadCount(void) const
+{
+    return (int)m_Workers.size() + 1;
+}
+
+void ThreadPool::WorkerLoop(int thread)
+{
+    unsigned int generation = 0;
+
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WakeCondition.wait(lock, [this, generation] { return m_Quit || m_Generation != generation; });
+            if(m_Quit)
+                return;
+            generation = m_Generation;
+        }
+
+        if(thread < m_ActiveThreads)
+            RunChunks(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if(--m_Pending == 0)
+                m_DoneCondition.notify_one();
+        }
+    }
+}
+
+void ThreadPool::RunChunks(int thread)
+{
+    while(true) {
+        int begin = m_NextIndex.fetch_add(m_ChunkSize);
+        if(begin >= m_JobCount)
+            return;
+        (*m_Job)(begin, std::min(begin + m_ChunkSize, m_JobCount), thread);
+    }
+}
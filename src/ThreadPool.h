@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// persistent workers that split an index range into chunks
+// the calling thread takes part as thread 0, so a pool of n threads owns n - 1 workers
+class ThreadPool
+{
+public:
+    typedef std::function<void(int begin, int end, int thread)> Job;
+
+    static int GetHardwareThreadCount(void);
+
+public:
+    ThreadPool(void);
+    ~ThreadPool();
+
+    void Init(int threadCount);
+    void Shutdown(void);
+    void ParallelFor(int count, int threadCount, const Job& job);
+
+    int GetThreadCount(void) const;
+
+private:
+    void WorkerLoop(int thread);
+    void RunChunks(int thread);
+
+private:
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition;
+    std::condition_variable m_DoneCondition;
+
+    const Job *m_Job = nullptr;
+    int m_JobCount = 0;
+    int m_ChunkSize = 0;
+    int m_ActiveThreads = 0;
+    std::atomic<int> m_NextIndex;
+    int m_Pending = 0;
+    unsigned int m_Generation = 0;
+    bool m_Quit = false;
+};
@@ -14,5 +14,5 @@ Vector RandomUnitSphere(void)
     float pitch = Random(-180.0f, 180.0f);
     float yaw = Random(0.0f, 360.0f);
 
-    return Matrix4::RotateY(yaw) * Matrix4::RotateX(pitch) * Vector(0.0f, 0.0f, -1.0f);
+    return AffineTransform::RotateY(yaw) * AffineTransform::RotateX(pitch) * Vector(0.0f, 0.0f, -1.0f);
 }
\ No newline at end of file